@@ -18,6 +18,7 @@
 #include <InputMonitors/InputMonitor.h>
 #include <Movement/Move.h>
 #include <General/SafeVsnprintf.h>
+#include <Hardware/EventLog.h>
 
 #define SUPPORT_CAN		1				// needed by CanDriver.h
 #include <CanDevice.h>
@@ -80,8 +81,12 @@ constexpr size_t CanAsyncSenderTaskStackWords = 100;
 static Task<CanAsyncSenderTaskStackWords> canAsyncSenderTask;
 
 static bool mainBoardAcknowledgedAnnounce = false;	// true after the main board has acknowledged our announcement
+static uint32_t whenAnnounceAcknowledged = 0;		// the time when the main board first acknowledged our announcement, for diagnostics
 static bool isProgrammed = false;					// true after the main board has sent us any configuration commands
 
+// CAN statistics accumulated since the last call to Diagnostics
+static unsigned int messagesQueuedForSending = 0, messagesReceived = 0, messagesLost = 0, busOffCount = 0;
+
 #if SUPPORT_DRIVERS
 static uint32_t lastMotionMessageScheduledTime = 0;
 static uint32_t lastMotionMessageReceivedAt = 0;
@@ -110,6 +115,37 @@ static CanMessageQueue PendingCommands;
 
 static Mutex txFifoMutex;
 
+// Live CAN timing changes. The master tells us when to switch to the new timing, then we monitor the bus for a while and go back to the old timing if there are too many errors.
+constexpr uint32_t TimingTrialMillis = 3000;						// must be longer than StepTimer::MinSyncInterval so that we notice if we stop receiving time sync messages
+constexpr uint32_t TimingTrialCheckInterval = 50;					// how often we check the error counters during a trial, in milliseconds
+constexpr unsigned int DefaultTimingErrorThreshold = 96;			// the transmit or receive error count above which we abandon the new timing
+constexpr size_t NumTimingStats = 4;								// how many different timings we keep statistics for
+
+static_assert(TimingTrialMillis > StepTimer::MinSyncInterval);
+
+enum class TimingChangeState : uint8_t { idle, pending, trial };
+
+struct CanTimingStats
+{
+	CanTiming timing;
+	unsigned int messagesReceived;
+	unsigned int messagesLost;
+	unsigned int busOffCount;
+	unsigned int maxErrorCount;
+	unsigned int fallbacks;
+};
+
+static Mutex statsMutex;												// protects the message counts and timing statistics, which both the main task and the async sender task update
+static CanTimingStats timingStats[NumTimingStats];
+static size_t numTimingStats = 0;
+static size_t currentTimingStatsIndex = 0;
+static CanTiming pendingTiming, previousTiming;
+static uint32_t whenToChangeTiming;									// local step clock time at which to switch to the pending timing
+static uint32_t whenTimingChanged;									// millis() when we switched
+static unsigned int timingErrorThreshold;
+static volatile TimingChangeState timingChangeState = TimingChangeState::idle;
+static StepTimer timingChangeTimer;
+
 #if OOS_DEBUG
 
 struct OosInfo
@@ -133,11 +169,156 @@ namespace CanInterface
 	CanMessageBuffer *ProcessReceivedMessage(CanMessageBuffer *buf) noexcept;
 }
 
+// Return the larger of the transmit and receive error counts from the error counter register
+static unsigned int GetErrorCount() noexcept
+{
+	const uint32_t ecr = can0dev->GetErrorRegister();
+	return max<unsigned int>(ecr & 0xFF, (ecr >> 8) & 0x7F);
+}
+
+// Collect the statistics from the CAN device and add them to the totals and to the statistics for the current timing. Caller must own statsMutex.
+static void AccumulateStats() noexcept
+{
+	unsigned int newMessagesQueuedForSending, newMessagesReceived, newMessagesLost, newBusOffCount;
+	can0dev->GetAndClearStats(newMessagesQueuedForSending, newMessagesReceived, newMessagesLost, newBusOffCount);
+	messagesQueuedForSending += newMessagesQueuedForSending;
+	messagesReceived += newMessagesReceived;
+	messagesLost += newMessagesLost;
+	busOffCount += newBusOffCount;
+
+	CanTimingStats& ts = timingStats[currentTimingStatsIndex];
+	ts.messagesReceived += newMessagesReceived;
+	ts.messagesLost += newMessagesLost;
+	ts.busOffCount += newBusOffCount;
+	const unsigned int errorCount = GetErrorCount();
+	if (errorCount > ts.maxErrorCount)
+	{
+		ts.maxErrorCount = errorCount;
+	}
+
+	if (newBusOffCount != 0)
+	{
+		EventLog::Record(EventLog::EventType::canBusOff, 0, newBusOffCount);
+	}
+}
+
+// Return the index of the statistics entry for the specified timing, creating one if necessary. If they are all in use, reuse the oldest one that isn't the current one.
+static size_t FindOrAddTimingStats(const CanTiming& timing) noexcept
+{
+	for (size_t i = 0; i < numTimingStats; ++i)
+	{
+		const CanTiming& t = timingStats[i].timing;
+		if (t.period == timing.period && t.tseg1 == timing.tseg1 && t.jumpWidth == timing.jumpWidth)
+		{
+			return i;
+		}
+	}
+
+	size_t index;
+	if (numTimingStats < NumTimingStats)
+	{
+		index = numTimingStats++;
+	}
+	else
+	{
+		const size_t discard = (currentTimingStatsIndex == 0) ? 1 : 0;
+		for (size_t i = discard + 1; i < NumTimingStats; ++i)
+		{
+			timingStats[i - 1] = timingStats[i];
+		}
+		if (currentTimingStatsIndex > discard)
+		{
+			--currentTimingStatsIndex;
+		}
+		index = NumTimingStats - 1;
+	}
+	CanTimingStats& ts = timingStats[index];
+	ts.timing = timing;
+	ts.messagesReceived = ts.messagesLost = ts.busOffCount = ts.maxErrorCount = ts.fallbacks = 0;
+	return index;
+}
+
+// Switch the CAN timing. Hold the transmit mutex so that we don't interrupt a message that is being queued.
+static void SetTiming(const CanTiming& timing) noexcept
+{
+	MutexLocker lock(txFifoMutex);
+	can0dev->SetLocalCanTiming(timing);
+}
+
+static void TimingChangeTimerCallback(CallbackParameter) noexcept
+{
+	CanInterface::WakeAsyncSenderFromIsr();
+}
+
+// Apply a pending timing change if it is due, or check how the bus is behaving if we are trialling a new timing.
+// Called by the async sender task. Return the maximum time in milliseconds before we need to be called again.
+static uint32_t CheckTimingChange() noexcept
+{
+	switch (timingChangeState)
+	{
+	case TimingChangeState::pending:
+		{
+			const int32_t ticksToGo = (int32_t)(whenToChangeTiming - StepTimer::GetTimerTicks());
+			if (ticksToGo > 0)
+			{
+				return (ticksToGo/(StepTimer::StepClockRate/1000)) + 1;		// the timer callback should wake us up before this
+			}
+		}
+		can0dev->GetLocalCanTiming(previousTiming);
+		{
+			MutexLocker lock(statsMutex);
+			AccumulateStats();											// assign the statistics so far to the old timing
+			SetTiming(pendingTiming);
+			currentTimingStatsIndex = FindOrAddTimingStats(pendingTiming);
+		}
+		whenTimingChanged = millis();
+		timingChangeState = TimingChangeState::trial;
+		return TimingTrialCheckInterval;
+
+	case TimingChangeState::trial:
+		{
+			const unsigned int errorCount = GetErrorCount();
+			MutexLocker lock(statsMutex);
+			CanTimingStats& ts = timingStats[currentTimingStatsIndex];
+			if (errorCount > ts.maxErrorCount)
+			{
+				ts.maxErrorCount = errorCount;
+			}
+
+			const uint32_t timeSinceChange = millis() - whenTimingChanged;
+			if (errorCount > timingErrorThreshold || (timeSinceChange >= TimingTrialMillis && !StepTimer::IsSynced()))
+			{
+				// Too many errors, or we have stopped receiving time sync messages from the master, so go back to the old timing
+				++ts.fallbacks;
+				AccumulateStats();
+				SetTiming(previousTiming);
+				currentTimingStatsIndex = FindOrAddTimingStats(previousTiming);
+				EventLog::Record(EventLog::EventType::canTimingFallback, 0, errorCount);
+				timingChangeState = TimingChangeState::idle;
+			}
+			else if (timeSinceChange >= TimingTrialMillis)
+			{
+				timingChangeState = TimingChangeState::idle;			// the new timing is good
+			}
+			else
+			{
+				return TimingTrialCheckInterval;
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+	return TaskBase::TimeoutUnlimited;
+}
+
 // Initialise this module and the CAN hardware
 void CanInterface::Init(CanAddress defaultBoardAddress, bool useAlternatePins, bool full) noexcept
 {
 	// Create the mutex
 	txFifoMutex.Create("CANtx");
+	statsMutex.Create("CANstats");
 
 	// Read the CAN timing data from the top part of the NVM User Row
 	canConfigData = *reinterpret_cast<CanUserAreaData*>(NVMCTRL_USER + CanUserAreaDataOffset);
@@ -198,6 +379,8 @@ void CanInterface::Init(CanAddress defaultBoardAddress, bool useAlternatePins, b
 	can0dev->Enable();
 
 	enabled = true;
+	can0dev->GetLocalCanTiming(timing);
+	currentTimingStatsIndex = FindOrAddTimingStats(timing);
 
 	if (full)
 	{
@@ -423,6 +606,10 @@ CanMessageBuffer *CanInterface::ProcessReceivedMessage(CanMessageBuffer *buf) no
 			break;
 
 		case CanMessageType::acknowledgeAnnounce:
+			if (!mainBoardAcknowledgedAnnounce)
+			{
+				whenAnnounceAcknowledged = millis();
+			}
 			mainBoardAcknowledgedAnnounce = true;
 			Platform::OnProcessingCanMessage();
 			break;
@@ -454,12 +641,21 @@ CanMessageBuffer *CanInterface::ProcessReceivedMessage(CanMessageBuffer *buf) no
 	return buf;
 }
 
+// Collect the statistics from the CAN device and log any bus off events. Called periodically by the main task.
+void CanInterface::CheckForBusOff() noexcept
+{
+	MutexLocker lock(statsMutex);
+	AccumulateStats();
+}
+
 void CanInterface::Diagnostics(const StringRef& reply) noexcept
 {
-	unsigned int messagesQueuedForSending, messagesReceived, messagesLost, busOffCount;
-	can0dev->GetAndClearStats(messagesQueuedForSending, messagesReceived, messagesLost, busOffCount);
-	reply.lcatf("CAN messages queued %u, send timeouts %u, received %u, lost %u, free buffers %u, min %u, error reg %" PRIx32,
-					messagesQueuedForSending, txTimeouts, messagesReceived, messagesLost, CanMessageBuffer::GetFreeBuffers(), CanMessageBuffer::GetAndClearMinFreeBuffers(), can0dev->GetErrorRegister());
+	MutexLocker lock(statsMutex);
+	AccumulateStats();
+	reply.lcatf("CAN messages queued %u, send timeouts %u, received %u, lost %u, bus off %u, free buffers %u, min %u, error reg %" PRIx32,
+					messagesQueuedForSending, txTimeouts, messagesReceived, messagesLost, busOffCount, CanMessageBuffer::GetFreeBuffers(), CanMessageBuffer::GetAndClearMinFreeBuffers(), can0dev->GetErrorRegister());
+	messagesQueuedForSending = messagesReceived = messagesLost = busOffCount = 0;
+	lock.Release();
 	txTimeouts = 0;
 	if (lastCancelledId != 0)
 	{
@@ -496,6 +692,11 @@ void CanInterface::SendAnnounce(CanMessageBuffer *buf) noexcept
 	}
 }
 
+uint32_t CanInterface::GetWhenAnnounceAcknowledged() noexcept
+{
+	return whenAnnounceAcknowledged;
+}
+
 // This is called from the step ISR when the move is stopped by the Z probe
 void CanInterface::MoveStoppedByZProbe() noexcept
 {
@@ -507,6 +708,11 @@ void CanInterface::WakeAsyncSenderFromIsr() noexcept
 	canAsyncSenderTask.GiveFromISR();
 }
 
+void CanInterface::WakeAsyncSender() noexcept
+{
+	canAsyncSenderTask.Give();
+}
+
 GCodeResult CanInterface::ChangeAddressAndDataRate(const CanMessageSetAddressAndNormalTiming &msg, const StringRef &reply) noexcept
 {
 	if (msg.oldAddress == boardAddress)
@@ -552,6 +758,61 @@ GCodeResult CanInterface::ChangeAddressAndDataRate(const CanMessageSetAddressAnd
 	return GCodeResult::error;
 }
 
+// Schedule a change to the CAN timing at the specified master step clock time. The new timing is not saved in NVM; use ChangeAddressAndDataRate to do that once a good timing has been found.
+// If the error count exceeds the threshold during the trial period after the change, or we stop receiving time sync messages, we go back to the old timing.
+GCodeResult CanInterface::ScheduleTimingChange(uint32_t whenToChange, uint16_t period, uint16_t tseg1, uint16_t jumpWidth, unsigned int errorThreshold, const StringRef& reply) noexcept
+{
+	if (timingChangeState != TimingChangeState::idle)
+	{
+		reply.copy("A CAN timing change is already in progress");
+		return GCodeResult::error;
+	}
+
+	if (period == 0 || tseg1 == 0 || tseg1 >= period || jumpWidth == 0 || jumpWidth >= period)
+	{
+		reply.copy("Bad CAN timing");
+		return GCodeResult::error;
+	}
+
+	if (!StepTimer::IsSynced())
+	{
+		reply.copy("Can't schedule a CAN timing change when not synced to the master");
+		return GCodeResult::error;
+	}
+
+	pendingTiming.period = period;
+	pendingTiming.tseg1 = tseg1;
+	pendingTiming.jumpWidth = jumpWidth;
+	timingErrorThreshold = (errorThreshold == 0) ? DefaultTimingErrorThreshold : errorThreshold;
+	whenToChangeTiming = StepTimer::ConvertToLocalTime(whenToChange);
+	timingChangeState = TimingChangeState::pending;
+
+	timingChangeTimer.SetCallback(TimingChangeTimerCallback, CallbackParameter(nullptr));
+	if (timingChangeTimer.ScheduleCallback(whenToChangeTiming))
+	{
+		WakeAsyncSender();						// it is already due
+	}
+	return GCodeResult::ok;
+}
+
+// Report the statistics for each CAN timing we have used
+void CanInterface::ReportTimingStats(const StringRef& reply) noexcept
+{
+	MutexLocker lock(statsMutex);
+	AccumulateStats();
+	reply.printf("CAN timing change %s", (timingChangeState == TimingChangeState::pending) ? "pending" : (timingChangeState == TimingChangeState::trial) ? "on trial" : "idle");
+	for (size_t i = 0; i < numTimingStats; ++i)
+	{
+		const CanTimingStats& ts = timingStats[i];
+		reply.lcatf("%c%.1fkbps, tseg1 %.2f, jump width %.2f: received %u, lost %u, bus off %u, max errors %u, fallbacks %u",
+						(i == currentTimingStatsIndex) ? '*' : ' ',
+						(double)((float)CanTiming::ClockFrequency/(1000 * ts.timing.period)),
+						(double)((float)ts.timing.tseg1/(float)ts.timing.period),
+						(double)((float)ts.timing.jumpWidth/(float)ts.timing.period),
+						ts.messagesReceived, ts.messagesLost, ts.busOffCount, ts.maxErrorCount, ts.fallbacks);
+	}
+}
+
 // Get a message, if there is one
 bool CanInterface::GetCanMessage(CanMessageBuffer *buf) noexcept
 {
@@ -638,7 +899,7 @@ extern "C" [[noreturn]] void CanAsyncSenderLoop(void *) noexcept
 			buf->dataLength = msg->GetActualDataLength();
 			CanInterface::SendAsync(buf);					// this doesn't free the buffer, so we can re-use it
 		}
-		TaskBase::Take(timeToWait);							// wait until we are woken up because a message is available, or we time out
+		TaskBase::Take(min<uint32_t>(timeToWait, CheckTimingChange()));							// wait until we are woken up because a message is available, or we time out
 	}
 }
 
@@ -21,10 +21,13 @@ namespace CanInterface
 	void Init(CanAddress defaultBoardAddress, bool useAlternatePins, bool full) noexcept;
 	void Shutdown() noexcept;
 	void Diagnostics(const StringRef& reply) noexcept;
+	void CheckForBusOff() noexcept;
 
 	CanAddress GetCanAddress() noexcept;
 	CanAddress GetCurrentMasterAddress() noexcept;
 	GCodeResult ChangeAddressAndDataRate(const CanMessageSetAddressAndNormalTiming& msg, const StringRef& reply) noexcept;
+	GCodeResult ScheduleTimingChange(uint32_t whenToChange, uint16_t period, uint16_t tseg1, uint16_t jumpWidth, unsigned int errorThreshold, const StringRef& reply) noexcept;
+	void ReportTimingStats(const StringRef& reply) noexcept;
 	bool GetCanMessage(CanMessageBuffer *buf) noexcept;
 	CanMessageBuffer *GetCanMove(uint32_t timeout) noexcept;
 	bool Send(CanMessageBuffer *buf) noexcept;
@@ -38,9 +41,11 @@ namespace CanInterface
 #endif
 
 	void SendAnnounce(CanMessageBuffer *buf) noexcept;
+	uint32_t GetWhenAnnounceAcknowledged() noexcept;
 
 	void MoveStoppedByZProbe() noexcept;
 	void WakeAsyncSenderFromIsr() noexcept;
+	void WakeAsyncSender() noexcept;
 }
 
 #endif /* SRC_CAN_CANINTERFACE_H_ */
@@ -15,6 +15,7 @@
 #include <Hardware/SharedSpiDevice.h>
 #include <ClosedLoop/ClosedLoop.h>
 #include <Platform.h>
+#include <Movement/StepTimer.h>
 
 /* The quadrature decoder is an attiny44.
  * At startup it reads the QuadratureErrorOut pin (which is also MOSI on the SPI bus) with the pullup resistor enabled.
@@ -25,8 +26,13 @@
 static constexpr uint32_t Attiny44aSignature = 0x1E9207;
 static constexpr uint32_t Attiny44aPageSize = 64;				// flash page size in bytes (32 words)
 
+// Until we know that the fuses select the external 16MHz clock, the attiny may be running from its internal 1MHz clock, so the SPI clock must be below 250kHz.
+// Once they do, the SPI clock can be up to 1/6 of 16MHz.
+static constexpr uint32_t SlowSpiClockFrequency = 125000;
+static constexpr uint32_t FastSpiClockFrequency = 2000000;
+
 //TODO use the attiny watchdog
-static const uint8_t AttinyProgram[] =
+static constexpr uint8_t AttinyProgram[] =
 {
 	// 0x0000 Interrupt vectors (RJMP instructions). First one jumps to CRT start, others jump to dummy ISR.
 	0x10, 0xC0, 0x22, 0xC0, 0x21, 0xC0, 0x20, 0xC0, 0x1F, 0xC0, 0x1E, 0xC0, 0x1D, 0xC0, 0x1C, 0xC0,
@@ -57,14 +63,40 @@ static const uint8_t AttinyProgram[] =
 	0x8A, 0x9A, 0xAA, 0x8A, 0xAA, 0xCA, 0xCA, 0x9A, 0x9A, 0xCA, 0xCA, 0xAA, 0x8A, 0xAA, 0x9A, 0x8A
 };
 
-static const uint8_t AttinyFuses[3] =
+static constexpr uint8_t AttinyFuses[3] =
 {
 	0x80,			// low fuse: external clock, not divided by 8
-	0xDF,			// high fuse: serial programming enabled
+	0xDF,			// high fuse: serial programming enabled, EEPROM not preserved through chip erase
 	0xFF			// extended fuse: self programming disabled
 };
 
-AttinyProgrammer::AttinyProgrammer(SharedSpiDevice& spiDev) noexcept : spi(spiDev, 125000, SpiMode::mode0, false), programStatus(AttinyProgErrorCode::notChecked)
+// After programming and verifying the attiny we store a CRC of the program and fuses in its EEPROM, followed by its complement.
+// At startup we need only read that and the fuses instead of the whole program. Because EEPROM is erased along with the flash,
+// a failed programming attempt leaves no signature behind.
+static constexpr uint8_t EepromSignatureAddress = 0;
+static constexpr size_t EepromSignatureLength = 4;
+
+static constexpr uint16_t Crc16(const uint8_t *data, size_t length, uint16_t crc) noexcept
+{
+	for (size_t i = 0; i < length; ++i)
+	{
+		crc ^= (uint16_t)data[i] << 8;
+		for (unsigned int bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+static constexpr uint16_t AttinyProgramCrc = Crc16(AttinyFuses, ARRAY_SIZE(AttinyFuses), Crc16(AttinyProgram, ARRAY_SIZE(AttinyProgram), 0xFFFF));
+
+static constexpr uint8_t AttinySignature[EepromSignatureLength] =
+{
+	(uint8_t)AttinyProgramCrc, (uint8_t)(AttinyProgramCrc >> 8), (uint8_t)~AttinyProgramCrc, (uint8_t)(~AttinyProgramCrc >> 8)
+};
+
+AttinyProgrammer::AttinyProgrammer(SharedSpiDevice& spiDev) noexcept : spi(spiDev, SlowSpiClockFrequency, SpiMode::mode0, false), programStatus(AttinyProgErrorCode::notChecked)
 {
 }
 
@@ -112,9 +144,18 @@ AttinyProgErrorCode AttinyProgrammer::SetupForProgramming() noexcept
 	return (deviceSignature == Attiny44aSignature) ? AttinyProgErrorCode::good : AttinyProgErrorCode::badDeviceId;
 }
 
+// Switch to the fast SPI clock. Only call this when the fuses are known to select the external clock.
+bool AttinyProgrammer::UseFastSpiClock() noexcept
+{
+	spi.Deselect();
+	spi.SetClockFrequency(FastSpiClockFrequency);
+	return spi.Select(10);
+}
+
 void AttinyProgrammer::EndProgramming() noexcept
 {
 	spi.Deselect();
+	spi.SetClockFrequency(SlowSpiClockFrequency);					// the next time we start, the fuses might not be right
 	ClosedLoop::DisableEncodersSpi();
 	digitalWrite(QuadratureResetPin, true);
 }
@@ -156,18 +197,47 @@ AttinyProgErrorCode AttinyProgrammer::DoVerify() noexcept
 		}
 	}
 
-	if (ret == AttinyProgErrorCode::good)
+	if (ret == AttinyProgErrorCode::good && !FusesOk())
 	{
-		if (   SendSpiQuad(0x50, 0x00, 0x00, 0x00) != AttinyFuses[0]
-			|| SendSpiQuad(0x58, 0x08, 0x00, 0x00) != AttinyFuses[1]
-			|| SendSpiQuad(0x50, 0x08, 0x00, 0x00) != AttinyFuses[2]
-		   )
+		ret = AttinyProgErrorCode::fuseVerifyFailed;
+	}
+
+	return ret;
+}
+
+// Check that the fuses have the values we want
+bool AttinyProgrammer::FusesOk() noexcept
+{
+	return SendSpiQuad(0x50, 0x00, 0x00, 0x00) == AttinyFuses[0]
+		&& SendSpiQuad(0x58, 0x08, 0x00, 0x00) == AttinyFuses[1]
+		&& SendSpiQuad(0x50, 0x08, 0x00, 0x00) == AttinyFuses[2];
+}
+
+// Check whether the signature in EEPROM matches our program and fuses
+bool AttinyProgrammer::SignatureOk() noexcept
+{
+	for (size_t i = 0; i < EepromSignatureLength; ++i)
+	{
+		if (SendSpiQuad(0xA0, 0x00, EepromSignatureAddress + i, 0x00) != AttinySignature[i])
 		{
-			ret = AttinyProgErrorCode::fuseVerifyFailed;
+			return false;
 		}
 	}
+	return true;
+}
 
-	return ret;
+// Store the signature in EEPROM. Only call this when the program and fuses have been verified.
+// If it fails we will just do a full verify next time.
+void AttinyProgrammer::WriteSignature() noexcept
+{
+	for (size_t i = 0; i < EepromSignatureLength; ++i)
+	{
+		SendSpiQuad(0xC0, 0x00, EepromSignatureAddress + i, AttinySignature[i]);
+		if (!WaitUntilAttinyReady())
+		{
+			break;
+		}
+	}
 }
 
 // Check that the decoder is running current firmware, return true if yes
@@ -176,7 +246,31 @@ AttinyProgErrorCode AttinyProgrammer::CheckProgram() noexcept
 	AttinyProgErrorCode ret = SetupForProgramming();
 	if (ret == AttinyProgErrorCode::good)
 	{
-		ret = DoVerify();
+		// Time the fuse reads so that we can tell how long a full verify at the slow clock speed would have taken
+		const uint32_t startTicks = StepTimer::GetTimerTicks();
+		const bool fusesOk = FusesOk();
+		fullVerifyMicroseconds = (StepTimer::TicksToIntegerMicroseconds(StepTimer::GetTimerTicks() - startTicks) * ARRAY_SIZE(AttinyProgram))/ARRAY_SIZE(AttinyFuses);
+		if (!fusesOk)
+		{
+			ret = AttinyProgErrorCode::fuseVerifyFailed;
+		}
+		else if (!UseFastSpiClock())
+		{
+			ret = AttinyProgErrorCode::spiBusy;
+		}
+		else if (SignatureOk())
+		{
+			verifiedBySignature = true;
+		}
+		else
+		{
+			// The attiny may have been programmed by older firmware that didn't store the signature, so check the program the long way
+			ret = DoVerify();
+			if (ret == AttinyProgErrorCode::good)
+			{
+				WriteSignature();
+			}
+		}
 	}
 
 	EndProgramming();
@@ -185,24 +279,43 @@ AttinyProgErrorCode AttinyProgrammer::CheckProgram() noexcept
 
 void AttinyProgrammer::InitAttiny()
 {
+	const uint32_t startTime = millis();
 	programStatus = CheckProgram();
 	if (programStatus == AttinyProgErrorCode::verifyFailed || programStatus == AttinyProgErrorCode::fuseVerifyFailed)
 	{
+		programmed = true;
 		programStatus = Program();
 	}
+	initMillis = millis() - startTime;
 	if (programStatus == AttinyProgErrorCode::good)
 	{
 		TurnAttinyOff();
 	}
 }
 
+// Append how we checked the attiny and how long it took
+void AttinyProgrammer::AppendInitDetails(const StringRef& reply) const noexcept
+{
+	reply.catf(", %s in %" PRIu32 "ms",
+				(programmed) ? "programmed" : (verifiedBySignature) ? "checked signature" : "verified", initMillis);
+	if (verifiedBySignature)
+	{
+		reply.catf(" (full verify would take about %" PRIu32 "ms more)", fullVerifyMicroseconds/1000);
+	}
+}
+
 // Update the program, return true if successful
 AttinyProgErrorCode AttinyProgrammer::Program() noexcept
 {
 	AttinyProgErrorCode ret = SetupForProgramming();
+	if (ret == AttinyProgErrorCode::good && FusesOk() && !UseFastSpiClock())
+	{
+		ret = AttinyProgErrorCode::spiBusy;
+	}
+
 	if (ret == AttinyProgErrorCode::good)
 	{
-		SendSpiQuad(0xAC, 0x80, 0x00, 0x00);						// send chip erase
+		SendSpiQuad(0xAC, 0x80, 0x00, 0x00);						// send chip erase, which erases the signature in EEPROM too
 		if (!WaitUntilAttinyReady())
 		{
 			ret = AttinyProgErrorCode::eraseTimeout;
@@ -251,6 +364,10 @@ AttinyProgErrorCode AttinyProgrammer::Program() noexcept
 	if (ret == AttinyProgErrorCode::good)
 	{
 		ret = DoVerify();
+		if (ret == AttinyProgErrorCode::good)
+		{
+			WriteSignature();
+		}
 	}
 
 	EndProgramming();
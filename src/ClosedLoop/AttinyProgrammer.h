@@ -35,11 +35,16 @@ public:
 	void InitAttiny() noexcept;
 	void TurnAttinyOff() noexcept;
 	AttinyProgErrorCode GetProgramStatus() noexcept { return programStatus; }
+	void AppendInitDetails(const StringRef& reply) const noexcept;
 
 private:
 	AttinyProgErrorCode CheckProgram() noexcept;	// Check that the decoder is running current firmware, return true if yes
 	AttinyProgErrorCode Program() noexcept;			// Update the program, return true if successful
 	AttinyProgErrorCode DoVerify() noexcept;
+	bool FusesOk() noexcept;
+	bool SignatureOk() noexcept;
+	void WriteSignature() noexcept;
+	bool UseFastSpiClock() noexcept;
 
 	uint8_t SendSpiQuad(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) noexcept;
 	AttinyProgErrorCode SetupForProgramming() noexcept;
@@ -48,7 +53,11 @@ private:
 
 	SharedSpiClient spi;
 	uint32_t deviceSignature = 0;
+	uint32_t initMillis = 0;						// how long InitAttiny took
+	uint32_t fullVerifyMicroseconds = 0;			// estimate of how long a full verify at the slow SPI clock would take
 	AttinyProgErrorCode programStatus;
+	bool verifiedBySignature = false;
+	bool programmed = false;
 };
 
 #endif
@@ -15,11 +15,14 @@
 #include "QuadratureEncoder.h"
 #include "TLI5012B.h"
 #include "AttinyProgrammer.h"
+#include "MicrostepCalibration.h"
 
 static bool closedLoopEnabled = false;
 static Encoder *encoder = nullptr;
 static SharedSpiDevice *encoderSpi = nullptr;
 static AttinyProgrammer *programmer;
+static MicrostepCalibration calibration;
+static Mutex encoderMutex;												// held while the encoder is replaced or used, so that it isn't deleted while in use
 
 static void GenerateAttinyClock()
 {
@@ -55,6 +58,7 @@ void  ClosedLoop::DisableEncodersSpi() noexcept
 void ClosedLoop::Init() noexcept
 {
 	pinMode(EncoderCsPin, OUTPUT_HIGH);													// make sure that any attached SPI encoder is not selected
+	encoderMutex.Create("Encoder");
 	encoderSpi = new SharedSpiDevice(EncoderSspiSercomNumber, EncoderSspiDataInPad);	// create the encoders SPI device
 	GenerateAttinyClock();
 	programmer = new AttinyProgrammer(*encoderSpi);
@@ -95,8 +99,11 @@ GCodeResult ClosedLoop::ProcessM569Point1(const CanMessageGeneric &msg, const St
 		{
 			if (temp != GetEncoderType().ToBaseType())
 			{
-				//TODO need to get a lock here in case there is any movement
+				// Stop the calibration and wait until nothing is using the old encoder before we delete it
+				MutexLocker lock(encoderMutex);
+				calibration.Abort();
 				delete encoder;
+				encoder = nullptr;
 				switch (temp)
 				{
 				case EncoderType::none:
@@ -140,14 +147,54 @@ GCodeResult ClosedLoop::ProcessM569Point1(const CanMessageGeneric &msg, const St
 	return GCodeResult::ok;
 }
 
+// Call this frequently from the main task
+void ClosedLoop::Spin() noexcept
+{
+	MutexLocker lock(encoderMutex);
+	calibration.Spin();
+}
+
+// Microstep calibration: 0 = start calibrating, 1 = use the calibrated microstep table, 2 = use the default table, 3 = report status
+GCodeResult ClosedLoop::ProcessMicrostepCalibration(uint32_t action, const StringRef& reply) noexcept
+{
+	switch (action)
+	{
+	case 0:
+		{
+			MutexLocker lock(encoderMutex);
+			return calibration.Start(encoder, reply);
+		}
+
+	case 1:
+	case 2:
+		{
+			MutexLocker lock(encoderMutex);
+			return calibration.ApplyCorrection(encoder, action == 1, reply);
+		}
+
+	case 3:
+		reply.copy("Microstep calibration");
+		calibration.AppendStatus(reply);
+		return GCodeResult::ok;
+
+	default:
+		reply.copy("Bad microstep calibration action");
+		return GCodeResult::error;
+	}
+}
+
 void ClosedLoop::Diagnostics(const StringRef& reply) noexcept
 {
-	reply.printf("Encoder programmed status %s, encoder type %s", programmer->GetProgramStatus().ToString(), GetEncoderType().ToString());
+	reply.printf("Encoder programmed status %s", programmer->GetProgramStatus().ToString());
+	programmer->AppendInitDetails(reply);
+	MutexLocker lock(encoderMutex);
+	reply.catf(", encoder type %s", GetEncoderType().ToString());
 	if (encoder != nullptr)
 	{
 		reply.catf(", position %" PRIi32, encoder->GetReading());
 		encoder->AppendDiagnostics(reply);
 	}
+	calibration.AppendStatus(reply);
 
 	//DEBUG
 	//reply.catf(", event status 0x%08" PRIx32 ", TCC2 CTRLA 0x%08" PRIx32 ", TCC2 EVCTRL 0x%08" PRIx32, EVSYS->CHSTATUS.reg, QuadratureTcc->CTRLA.reg, QuadratureTcc->EVCTRL.reg);
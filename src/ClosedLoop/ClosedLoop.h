@@ -25,6 +25,8 @@ namespace ClosedLoop
 	EncoderType GetEncoderType() noexcept;
 	GCodeResult ProcessM569Point1(const CanMessageGeneric& msg, const StringRef& reply) noexcept;
 	void Diagnostics(const StringRef& reply) noexcept;
+	void Spin() noexcept;
+	GCodeResult ProcessMicrostepCalibration(uint32_t action, const StringRef& reply) noexcept;
 
 	void EnableEncodersSpi() noexcept;
 	void DisableEncodersSpi() noexcept;
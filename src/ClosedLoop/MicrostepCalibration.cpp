@@ -0,0 +1,408 @@
+/*
+ * MicrostepCalibration.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#include "MicrostepCalibration.h"
+
+#if SUPPORT_CLOSED_LOOP
+
+#include "Encoder.h"
+#include <Platform.h>
+#include <Movement/Move.h>
+
+#if !SINGLE_DRIVER
+# error Microstep calibration assumes a single driver
+#endif
+
+constexpr float MinEncoderCountsPerCycle = 16.0;
+
+GCodeResult MicrostepCalibration::Start(Encoder *enc, const StringRef& reply) noexcept
+{
+	if (enc == nullptr)
+	{
+		reply.copy("No encoder configured");
+		return GCodeResult::error;
+	}
+
+	if (IsRunning())
+	{
+		reply.copy("Microstep calibration is already running");
+		return GCodeResult::error;
+	}
+
+	if (moveInstance->IsMoving())
+	{
+		reply.copy("Can't calibrate while the motor is moving");
+		return GCodeResult::error;
+	}
+
+	bool interpolation;
+	const unsigned int microsteps = SmartDrivers::GetMicrostepping(0, interpolation);
+	if (microsteps < PointsPerFullStep)
+	{
+		reply.printf("Microstepping must be at least %u to calibrate", PointsPerFullStep);
+		return GCodeResult::error;
+	}
+
+	// Measure the motor with the standard sine table, not with a previous correction
+	SmartDrivers::SetMicrostepTable(0, SmartDrivers::DefaultMsLut, SmartDrivers::DefaultMsLutSel, SmartDrivers::DefaultMsLutStart);
+	correctionApplied = false;
+	tableValid = false;
+	residualValid = false;
+	StartRun(enc, microsteps, false);
+	return GCodeResult::ok;
+}
+
+// Start a measurement run. If 'verify' is true then we are measuring the error that remains with the corrected table, so we don't recalculate the table.
+void MicrostepCalibration::StartRun(Encoder *enc, unsigned int microsteps, bool verify) noexcept
+{
+	failureReason = nullptr;
+	Platform::EnableDrive(0);
+	encoder = enc;
+	verifying = verify;
+	microstepsPerPoint = microsteps/PointsPerFullStep;
+	pointNumber = 0;
+	whenLastMoved = millis();
+	phase = Phase::preroll;
+}
+
+void MicrostepCalibration::Abort() noexcept
+{
+	if (IsRunning())
+	{
+		phase = Phase::idle;
+		failureReason = "aborted";
+	}
+}
+
+// Move one point forwards or backwards, or abandon the calibration if the move system is busy.
+// The move task starts moves, so we stop task switching while we check that there is no move and step the motor. A point takes at most about 70us.
+void MicrostepCalibration::MovePoint(bool forwards) noexcept
+{
+	TaskCriticalSectionLocker lock;
+	if (moveInstance->IsMoving())
+	{
+		phase = Phase::idle;
+		failureReason = "motor was commanded to move";
+		return;
+	}
+
+	Platform::SetDirection(forwards);
+	delayMicroseconds(1);												// direction setup time
+	for (unsigned int i = 0; i < microstepsPerPoint; ++i)
+	{
+		Platform::StepDriverHigh();
+		delayMicroseconds(2);
+		Platform::StepDriverLow();
+		delayMicroseconds(2);
+	}
+	whenLastMoved = millis();
+}
+
+// Read the encoder several times to reduce noise. We only use differences between readings scaled by the change over a whole cycle, so we needn't divide the sum.
+int32_t MicrostepCalibration::ReadEncoder() noexcept
+{
+	int32_t sum = 0;
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		sum += encoder->GetReading();
+	}
+	return sum;
+}
+
+void MicrostepCalibration::Spin() noexcept
+{
+	if (phase == Phase::idle || millis() - whenLastMoved < SettleMillis)
+	{
+		return;
+	}
+
+	if (moveInstance->IsMoving())
+	{
+		phase = Phase::idle;
+		failureReason = "motor was commanded to move";
+		return;
+	}
+
+	switch (phase)
+	{
+	case Phase::preroll:
+		// Move forwards one full step before we start measuring, so that any backlash has been taken up
+		if (pointNumber < PointsPerFullStep)
+		{
+			MovePoint(true);
+			++pointNumber;
+		}
+		else
+		{
+			startMsCnt = SmartDrivers::GetRegister(0, SmartDriverRegister::mstepPos);
+			pointNumber = 0;
+			phase = Phase::forward;
+		}
+		break;
+
+	case Phase::forward:
+		forwardReadings[pointNumber] = ReadEncoder();
+		if (pointNumber == PointsPerFullStep)
+		{
+			fullStepMsCnt = SmartDrivers::GetRegister(0, SmartDriverRegister::mstepPos);
+		}
+		if (pointNumber == PointsPerCycle)
+		{
+			backwardReadings[pointNumber] = forwardReadings[pointNumber];
+			phase = Phase::backward;
+			MovePoint(false);
+			--pointNumber;
+		}
+		else
+		{
+			MovePoint(true);
+			++pointNumber;
+		}
+		break;
+
+	case Phase::backward:
+		backwardReadings[pointNumber] = ReadEncoder();
+		if (pointNumber == 0)
+		{
+			pointNumber = PointsPerFullStep;
+			phase = Phase::returning;
+		}
+		else
+		{
+			MovePoint(false);
+			--pointNumber;
+		}
+		break;
+
+	case Phase::returning:
+		// Undo the preroll so that the motor finishes where it started
+		if (pointNumber != 0)
+		{
+			MovePoint(false);
+			--pointNumber;
+		}
+		else
+		{
+			phase = Phase::idle;
+			Finish();
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Calculate the errors from the readings and build the corrected microstep table
+void MicrostepCalibration::Finish() noexcept
+{
+	// We average the forward and backward readings so that backlash and friction cancel out
+	const int32_t startReading = forwardReadings[0] + backwardReadings[0];
+	const float countsPerCycle = (float)(forwardReadings[PointsPerCycle] + backwardReadings[PointsPerCycle] - startReading) * 0.5;
+	if (fabsf(countsPerCycle) < MinEncoderCountsPerCycle * 4)			// the readings are the sum of 4 encoder readings
+	{
+		failureReason = "encoder did not move";
+		return;
+	}
+
+	// Find out which way the microstep counter moves when we step forwards, so that we can relate the points to the microstep table
+	const uint32_t fullStepMsCntChange = (fullStepMsCnt - startMsCnt) & (MsCntPerCycle - 1);
+	if (fullStepMsCntChange != TableSize && fullStepMsCntChange != MsCntPerCycle - TableSize)
+	{
+		failureReason = "microstep counter did not follow the steps";
+		return;
+	}
+	const int msCntDirection = (fullStepMsCntChange == TableSize) ? 1 : -1;
+
+	// Calculate the position error at each point in units of 1/256 full step, positive when the motor is ahead in the direction of increasing microstep count.
+	// Average the errors at corresponding points in the 4 full steps.
+	constexpr unsigned int MsCntPerPoint = MsCntPerCycle/PointsPerCycle;
+	const unsigned int binOffset = startMsCnt % MsCntPerPoint;
+	float binErrors[PointsPerFullStep];
+	for (float& f : binErrors)
+	{
+		f = 0.0;
+	}
+
+	float minError = 0.0, maxError = 0.0, hysteresisSum = 0.0;
+	for (unsigned int i = 0; i < PointsPerCycle; ++i)
+	{
+		const float position = (float)(forwardReadings[i] + backwardReadings[i] - startReading) * 0.5;
+		const float error = (float)msCntDirection * (position * (float)MsCntPerCycle/countsPerCycle - (float)(i * MsCntPerPoint));
+		if (i == 0 || error < minError) { minError = error; }
+		if (i == 0 || error > maxError) { maxError = error; }
+		hysteresisSum += fabsf((float)(forwardReadings[i] - backwardReadings[i]) * (float)MsCntPerCycle/countsPerCycle);
+
+		const uint32_t msCnt = (startMsCnt + (uint32_t)(msCntDirection * (int)(i * MsCntPerPoint))) & (MsCntPerCycle - 1);
+		binErrors[((msCnt % TableSize) - binOffset)/MsCntPerPoint] += error * 0.25;
+	}
+
+	if (verifying)
+	{
+		residualPeakToPeak = maxError - minError;
+		residualValid = true;
+		return;
+	}
+
+	errorPeakToPeak = maxError - minError;
+	hysteresis = hysteresisSum/PointsPerCycle;
+	CalculateTable(binErrors, binOffset);
+	tableValid = true;
+}
+
+// Build the microstep table that compensates for the measured errors
+void MicrostepCalibration::CalculateTable(const float binErrors[PointsPerFullStep], unsigned int binOffset) noexcept
+{
+	constexpr unsigned int EntriesPerBin = TableSize/PointsPerFullStep;
+
+	// Interpolate the error at any table index, treating it as periodic over one full step
+	auto errorAt = [binErrors, binOffset](unsigned int k) noexcept -> float
+	{
+		const unsigned int pos = (k + TableSize - binOffset) % TableSize;
+		const unsigned int bin = pos/EntriesPerBin;
+		const float frac = (float)(pos % EntriesPerBin)/(float)EntriesPerBin;
+		return binErrors[bin] * (1.0 - frac) + binErrors[(bin + 1) % PointsPerFullStep] * frac;
+	};
+
+	// The table holds a quarter wave and the driver mirrors it to get the other quarters and the cosine,
+	// so we can only correct the part of the error that is antisymmetric about the middle of the full step
+	auto correctionAt = [&errorAt](unsigned int k) noexcept -> float
+	{
+		return constrain<float>((errorAt(k) - errorAt(TableSize - k)) * 0.5, -MaxCorrection, MaxCorrection);
+	};
+
+	// To make the motor reach position k we must point the current vector at k minus the error there
+	auto tableValueAt = [&correctionAt](unsigned int k) noexcept -> float
+	{
+		const float angle = constrain<float>((float)k - correctionAt(k), 0.0, (float)TableSize);
+		return TableAmplitude * sinf(angle * (Pi * 0.5)/(float)TableSize);
+	};
+
+	float minResidual = 0.0, maxResidual = 0.0;
+	for (unsigned int k = 0; k < TableSize; ++k)
+	{
+		const float residual = errorAt(k) - correctionAt(k);
+		if (k == 0 || residual < minResidual) { minResidual = residual; }
+		if (k == 0 || residual > maxResidual) { maxResidual = residual; }
+	}
+	uncorrectablePeakToPeak = maxResidual - minResidual;
+
+	// Encode the table as differences. We can use up to 4 segments, each allowing two adjacent difference values W-1 and W.
+	// We choose each difference to keep the encoded table as close as possible to the ideal one, and start a new segment when neither value is close enough.
+	auto chooseWidth = [&tableValueAt](unsigned int k, int32_t current) noexcept -> uint32_t
+	{
+		const unsigned int end = min<unsigned int>(k + 8, TableSize);
+		const float slope = (tableValueAt(end) - (float)current)/(float)(end - k);
+		return (uint32_t)constrain<int>((int)floorf(slope) + 1, 0, 3);
+	};
+
+	for (uint32_t& lut : msLut)
+	{
+		lut = 0;
+	}
+	uint32_t widths[4];
+	uint32_t segmentStarts[3] = { TableSize - 1, TableSize - 1, TableSize - 1 };
+	int32_t current = lrintf(tableValueAt(0));
+	const int32_t startSin = current;
+	unsigned int segment = 0;
+	widths[0] = chooseWidth(0, current);
+	for (unsigned int k = 0; k < TableSize; ++k)
+	{
+		const float wanted = tableValueAt(k + 1) - (float)current;
+		auto nearest = [wanted](uint32_t w) noexcept -> int32_t { return (wanted >= (float)w - 0.5) ? (int32_t)w : (int32_t)w - 1; };
+		int32_t delta = nearest(widths[segment]);
+		if (fabsf(wanted - (float)delta) > 0.75 && segment < 3 && k != 0)
+		{
+			segmentStarts[segment] = k;
+			++segment;
+			widths[segment] = chooseWidth(k, current);
+			delta = nearest(widths[segment]);
+		}
+		if (delta == (int32_t)widths[segment])
+		{
+			msLut[k/32] |= 1u << (k % 32);
+		}
+		current += delta;
+	}
+
+	for (unsigned int i = segment + 1; i < 4; ++i)
+	{
+		widths[i] = widths[segment];
+	}
+	msLutSel = widths[0] | (widths[1] << 2) | (widths[2] << 4) | (widths[3] << 6) | (segmentStarts[0] << 8) | (segmentStarts[1] << 16) | (segmentStarts[2] << 24);
+	msLutStart = (uint32_t)startSin | ((uint32_t)constrain<int32_t>(current, 0, 255) << 16);
+}
+
+// Send the corrected or the default table to the driver. After applying the corrected table we measure the motor again to find the residual error.
+GCodeResult MicrostepCalibration::ApplyCorrection(Encoder *enc, bool apply, const StringRef& reply) noexcept
+{
+	if (IsRunning())
+	{
+		reply.copy("Microstep calibration is running");
+		return GCodeResult::error;
+	}
+
+	// Changing the table while the motor is moving would make it jump
+	if (moveInstance->IsMoving())
+	{
+		reply.copy("Can't change the microstep table while the motor is moving");
+		return GCodeResult::error;
+	}
+
+	residualValid = false;
+	if (apply)
+	{
+		if (!tableValid)
+		{
+			reply.copy("No microstep calibration available");
+			return GCodeResult::error;
+		}
+		if (enc == nullptr)
+		{
+			reply.copy("No encoder configured");
+			return GCodeResult::error;
+		}
+		SmartDrivers::SetMicrostepTable(0, msLut, msLutSel, msLutStart);
+		correctionApplied = true;
+
+		bool interpolation;
+		StartRun(enc, SmartDrivers::GetMicrostepping(0, interpolation), true);
+	}
+	else
+	{
+		SmartDrivers::SetMicrostepTable(0, SmartDrivers::DefaultMsLut, SmartDrivers::DefaultMsLutSel, SmartDrivers::DefaultMsLutStart);
+		correctionApplied = false;
+	}
+	return GCodeResult::ok;
+}
+
+void MicrostepCalibration::AppendStatus(const StringRef& reply) const noexcept
+{
+	if (IsRunning())
+	{
+		reply.cat((verifying) ? ", microstep calibration checking the correction" : ", microstep calibration in progress");
+		return;
+	}
+
+	if (failureReason != nullptr)
+	{
+		reply.catf((verifying) ? ", microstep correction check failed: %s" : ", microstep calibration failed: %s", failureReason);
+	}
+	if (tableValid)
+	{
+		reply.catf(", microstep error %.1f/256 full step peak-to-peak, %.1f uncorrectable, hysteresis %.1f, correction %s",
+					(double)errorPeakToPeak, (double)uncorrectablePeakToPeak, (double)hysteresis, (correctionApplied) ? "applied" : "not applied");
+		if (residualValid)
+		{
+			reply.catf(", residual error %.1f", (double)residualPeakToPeak);
+		}
+	}
+}
+
+#endif
+
+// End
@@ -0,0 +1,83 @@
+/*
+ * MicrostepCalibration.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ *
+ *  Measure the microstep position error of the motor using the encoder, and build a corrected TMC51xx microstep table to compensate for it.
+ *  The calibration steps slowly through one electrical cycle in each direction, reading the encoder after the motor has settled at each point.
+ *  The error is folded into one full step and converted into a correction of the angle of the current vector at each microstep position.
+ *  When the corrected table is applied we measure the motor again with it, to find the error that remains.
+ */
+
+#ifndef SRC_CLOSEDLOOP_MICROSTEPCALIBRATION_H_
+#define SRC_CLOSEDLOOP_MICROSTEPCALIBRATION_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_CLOSED_LOOP
+
+#include <GCodes/GCodeResult.h>
+#include <Movement/StepperDrivers/TMC51xx.h>
+
+class Encoder;
+
+class MicrostepCalibration
+{
+public:
+	static constexpr unsigned int PointsPerCycle = 64;							// number of points we measure per electrical cycle
+	static constexpr unsigned int PointsPerFullStep = PointsPerCycle/4;
+
+	MicrostepCalibration() noexcept { }
+
+	GCodeResult Start(Encoder *enc, const StringRef& reply) noexcept;
+	void Spin() noexcept;														// call this frequently from the main task while calibrating
+	void Abort() noexcept;
+	bool IsRunning() const noexcept { return phase != Phase::idle; }
+	GCodeResult ApplyCorrection(Encoder *enc, bool apply, const StringRef& reply) noexcept;	// send the corrected or the default microstep table to the driver
+	void AppendStatus(const StringRef& reply) const noexcept;
+
+private:
+	enum class Phase : uint8_t { idle, preroll, forward, backward, returning };
+
+	static constexpr uint32_t SettleMillis = 20;								// how long we wait after each move before we read the encoder
+	static constexpr unsigned int TableSize = 256;								// number of entries in a quarter wave of the microstep table
+	static constexpr unsigned int MsCntPerCycle = 4 * TableSize;
+	static constexpr float MaxCorrection = 32.0;								// the largest correction we apply, in 1/256 full steps
+	static constexpr float TableAmplitude = 247.0;
+
+	void StartRun(Encoder *enc, unsigned int microsteps, bool verify) noexcept;
+	void MovePoint(bool forwards) noexcept;
+	int32_t ReadEncoder() noexcept;
+	void Finish() noexcept;
+	void CalculateTable(const float binErrors[PointsPerFullStep], unsigned int binOffset) noexcept;
+
+	Encoder *encoder = nullptr;
+	uint32_t whenLastMoved;
+	unsigned int pointNumber;
+	unsigned int microstepsPerPoint;
+	uint32_t startMsCnt;
+	uint32_t fullStepMsCnt;
+	Phase phase = Phase::idle;
+	bool verifying = false;														// true if we are measuring the motor with the corrected table
+
+	// Results
+	bool tableValid = false;
+	bool correctionApplied = false;
+	float errorPeakToPeak;														// measured error in 1/256 full steps
+	float uncorrectablePeakToPeak;												// the part of the error that the table can't correct
+	float hysteresis;															// mean difference between forward and backward readings, in 1/256 full steps
+	bool residualValid = false;
+	float residualPeakToPeak;													// error measured with the corrected table applied, in 1/256 full steps
+	const char *failureReason = nullptr;
+	uint32_t msLut[SmartDrivers::NumMsLutRegisters];
+	uint32_t msLutSel;
+	uint32_t msLutStart;
+
+	int32_t forwardReadings[PointsPerCycle + 1];
+	int32_t backwardReadings[PointsPerCycle + 1];
+};
+
+#endif
+
+#endif /* SRC_CLOSEDLOOP_MICROSTEPCALIBRATION_H_ */
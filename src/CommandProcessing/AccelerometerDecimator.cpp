@@ -0,0 +1,108 @@
+/*
+ * AccelerometerDecimator.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#include "AccelerometerDecimator.h"
+
+// Set the decimation factor and calculate the filter coefficients. Return false if the factor is out of range.
+// The cutoff frequency is 80% of the Nyquist frequency of the decimated stream, leaving the rest of the band for the filter to roll off.
+bool AccelerometerDecimator::Configure(unsigned int p_factor) noexcept
+{
+	if (p_factor == 0 || p_factor > MaxFactor)
+	{
+		return false;
+	}
+
+	factor = p_factor;
+	if (factor == 1)
+	{
+		numTaps = 1;
+		coefficients[0] = 0;									// not used, we pass samples straight through
+	}
+	else
+	{
+		numTaps = TapsPerFactor * factor + 1;
+		const float cutoff = 0.4/(float)factor;					// as a fraction of the input sample rate
+		const int centre = (int)numTaps/2;
+		float rawCoefficients[MaxTaps];
+		float sum = 0.0;
+		for (int i = 0; i < (int)numTaps; ++i)
+		{
+			const int n = i - centre;
+			const float sinc = (n == 0) ? 2.0 * cutoff : sinf(TwoPi * cutoff * n)/(Pi * n);
+			const float window = 0.54 - 0.46 * cosf(TwoPi * i/(float)(numTaps - 1));
+			rawCoefficients[i] = sinc * window;
+			sum += rawCoefficients[i];
+		}
+
+		// Scale the coefficients for unity gain at DC and put any rounding error into the centre one, so that the gain is exact
+		int32_t intSum = 0;
+		for (unsigned int i = 0; i < numTaps; ++i)
+		{
+			coefficients[i] = (int16_t)lrintf(rawCoefficients[i] * (float)(1u << CoefficientFractionBits)/sum);
+			intSum += coefficients[i];
+		}
+		coefficients[centre] += (int16_t)((1 << CoefficientFractionBits) - intSum);
+	}
+	writeIndex = 0;
+	Reset();
+	return true;
+}
+
+// Add a sample. If this is one of the samples we keep, set 'out' to the filtered value and return true.
+bool AccelerometerDecimator::Process(int32_t val, int32_t& out) noexcept
+{
+	if (factor == 1)
+	{
+		out = val;
+		return true;
+	}
+
+	if (!primed)
+	{
+		// Fill the history with the first sample to avoid a large transient at the start
+		for (unsigned int i = 0; i < numTaps; ++i)
+		{
+			history[i] = val;
+		}
+		writeIndex = 0;
+		primed = true;
+	}
+	else
+	{
+		history[writeIndex] = val;
+		++writeIndex;
+		if (writeIndex == numTaps)
+		{
+			writeIndex = 0;
+		}
+	}
+
+	++phase;
+	if (phase < factor)
+	{
+		return false;
+	}
+	phase = 0;
+
+	// The filter is symmetrical so we don't need to worry about the order in which we apply the coefficients.
+	// Input samples are at most 16 bits and the sum of the coefficient magnitudes is only a little more than 1.0, so 32-bit arithmetic can't overflow.
+	int32_t acc = 0;
+	unsigned int j = writeIndex;
+	for (unsigned int i = 0; i < numTaps; ++i)
+	{
+		acc += history[j] * coefficients[i];
+		++j;
+		if (j == numTaps)
+		{
+			j = 0;
+		}
+	}
+	out = (acc + (1 << (CoefficientFractionBits - 1))) >> CoefficientFractionBits;
+	return true;
+}
+
+// End
@@ -0,0 +1,42 @@
+/*
+ * AccelerometerDecimator.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ *
+ *  Anti-alias low pass filter and decimator for a single stream of accelerometer samples.
+ *  The filter is a Hamming-windowed sinc FIR filter with integer coefficients, evaluated only for the samples that we keep.
+ */
+
+#ifndef SRC_COMMANDPROCESSING_ACCELEROMETERDECIMATOR_H_
+#define SRC_COMMANDPROCESSING_ACCELEROMETERDECIMATOR_H_
+
+#include <RepRapFirmware.h>
+
+class AccelerometerDecimator
+{
+public:
+	static constexpr unsigned int MaxFactor = 8;
+	static constexpr unsigned int TapsPerFactor = 8;
+	static constexpr unsigned int MaxTaps = TapsPerFactor * MaxFactor + 1;
+
+	AccelerometerDecimator() noexcept { Configure(1); }
+
+	bool Configure(unsigned int p_factor) noexcept;				// set the decimation factor and calculate the filter coefficients
+	void Reset() noexcept { phase = 0; primed = false; }		// call this before starting a new stream of samples
+	bool Process(int32_t val, int32_t& out) noexcept;			// add a sample, returning true and setting 'out' if this is a sample we keep
+	unsigned int GetFactor() const noexcept { return factor; }
+
+private:
+	static constexpr unsigned int CoefficientFractionBits = 15;
+
+	int16_t coefficients[MaxTaps];
+	int32_t history[MaxTaps];
+	unsigned int numTaps;
+	unsigned int factor;
+	unsigned int phase;
+	unsigned int writeIndex;
+	bool primed;
+};
+
+#endif /* SRC_COMMANDPROCESSING_ACCELEROMETERDECIMATOR_H_ */
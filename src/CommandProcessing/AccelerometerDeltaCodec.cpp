@@ -0,0 +1,169 @@
+/*
+ * AccelerometerDeltaCodec.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#include "AccelerometerDeltaCodec.h"
+
+using namespace AccelerometerDeltaCodec;
+
+static inline uint32_t ZigzagEncode(int32_t val) noexcept
+{
+	return ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+}
+
+static inline int32_t ZigzagDecode(uint32_t val) noexcept
+{
+	return (int32_t)(val >> 1) ^ -(int32_t)(val & 1u);
+}
+
+static inline int32_t SignExtend(uint32_t val, unsigned int numBits) noexcept
+{
+	return (int32_t)(val << (32u - numBits)) >> (32u - numBits);
+}
+
+void Encoder::Start(uint16_t *p_data, size_t p_numWords, unsigned int p_numAxes, unsigned int p_resolution) noexcept
+{
+	data = p_data;
+	numWords = p_numWords;
+	numAxes = p_numAxes;
+	resolution = p_resolution;
+	wordsWritten = 0;
+	bitsPending = 0;
+	numBitsPending = 0;
+	bitsUsed = 0;
+	for (AxisState& as : axisStates)
+	{
+		as.Reset();
+	}
+}
+
+void Encoder::PutBits(uint32_t val, unsigned int numBits) noexcept
+{
+	bitsPending |= (val & ((1u << numBits) - 1)) << numBitsPending;
+	numBitsPending += numBits;
+	bitsUsed += numBits;
+	if (numBitsPending >= 16)
+	{
+		data[wordsWritten++] = (uint16_t)bitsPending;
+		bitsPending >>= 16;
+		numBitsPending -= 16;
+	}
+}
+
+void Encoder::AddValue(unsigned int axisIndex, int32_t val) noexcept
+{
+	AxisState& as = axisStates[axisIndex];
+	if (!as.HaveSeenSample())
+	{
+		// First sample of this axis in the packet, so send it in full
+		PutBits((uint32_t)val, resolution);
+		as.Update(val, 0);
+		return;
+	}
+
+	const uint32_t error = ZigzagEncode(val - as.Predict());
+	const unsigned int k = as.GetRiceParameter(resolution);
+	const uint32_t quotient = error >> k;
+	if (quotient < EscapeLength)
+	{
+		PutBits((1u << quotient) - 1, quotient + 1);				// unary quotient terminated by a zero bit
+		PutBits(error, k);
+	}
+	else
+	{
+		PutBits((1u << EscapeLength) - 1, EscapeLength);
+		PutBits((uint32_t)val, resolution);
+	}
+	as.Update(val, error);
+}
+
+size_t Encoder::Finish() noexcept
+{
+	if (numBitsPending != 0)
+	{
+		data[wordsWritten++] = (uint16_t)bitsPending;
+		bitsPending = 0;
+		numBitsPending = 0;
+	}
+	return wordsWritten;
+}
+
+// Reference decoder. The main board needs an equivalent of this to use delta encoded packets.
+bool AccelerometerDeltaCodec::Decode(const uint16_t *data, size_t numWords, unsigned int numAxes, unsigned int resolution, unsigned int numSamples, int16_t *values) noexcept
+{
+	AxisState axisStates[MaxAxes];
+	for (AxisState& as : axisStates)
+	{
+		as.Reset();
+	}
+
+	size_t wordsRead = 0;
+	uint32_t bitsAvailable = 0;
+	unsigned int numBitsAvailable = 0;
+
+	// Return the next numBits bits (at most 16), or false if we have run out of data
+	auto getBits = [&](unsigned int numBits, uint32_t& val) noexcept -> bool
+	{
+		if (numBitsAvailable < numBits)
+		{
+			if (wordsRead == numWords)
+			{
+				return false;
+			}
+			bitsAvailable |= (uint32_t)data[wordsRead++] << numBitsAvailable;
+			numBitsAvailable += 16;
+		}
+		val = bitsAvailable & ((1u << numBits) - 1);
+		bitsAvailable >>= numBits;
+		numBitsAvailable -= numBits;
+		return true;
+	};
+
+	for (unsigned int sample = 0; sample < numSamples; ++sample)
+	{
+		for (unsigned int axisIndex = 0; axisIndex < numAxes; ++axisIndex)
+		{
+			AxisState& as = axisStates[axisIndex];
+			uint32_t bits;
+			int32_t val;
+			uint32_t error = 0;
+			if (!as.HaveSeenSample())
+			{
+				if (!getBits(resolution, bits)) { return false; }
+				val = SignExtend(bits, resolution);
+			}
+			else
+			{
+				uint32_t quotient = 0;
+				for (;;)
+				{
+					if (!getBits(1, bits)) { return false; }
+					if (bits == 0) { break; }
+					if (++quotient == EscapeLength) { break; }
+				}
+
+				if (quotient == EscapeLength)
+				{
+					if (!getBits(resolution, bits)) { return false; }
+					val = SignExtend(bits, resolution);
+					error = ZigzagEncode(val - as.Predict());
+				}
+				else
+				{
+					const unsigned int k = as.GetRiceParameter(resolution);
+					if (!getBits(k, bits)) { return false; }
+					error = (quotient << k) | bits;
+					val = as.Predict() + ZigzagDecode(error);
+				}
+			}
+			as.Update(val, error);
+			*values++ = (int16_t)val;
+		}
+	}
+	return true;
+}
+
+// End
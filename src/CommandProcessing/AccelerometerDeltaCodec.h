@@ -0,0 +1,103 @@
+/*
+ * AccelerometerDeltaCodec.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ *
+ *  Lossless encoding of accelerometer samples sent in CanMessageAccelerometerData.
+ *  Within a packet the first sample of each axis is sent in full. Each later sample is predicted from the previous two samples of the same axis
+ *  and the prediction error is sent as an adaptive Rice code, which is short when the signal is smooth. Errors too large to Rice code are sent as
+ *  an escape code followed by the full sample. Each packet can be decoded on its own, so a lost packet doesn't affect the others.
+ *  Bits are packed into 16-bit words starting at the least significant bit, the same as for unencoded samples.
+ */
+
+#ifndef SRC_COMMANDPROCESSING_ACCELEROMETERDELTACODEC_H_
+#define SRC_COMMANDPROCESSING_ACCELEROMETERDELTACODEC_H_
+
+#include <RepRapFirmware.h>
+
+namespace AccelerometerDeltaCodec
+{
+	constexpr unsigned int MaxAxes = 3;
+	constexpr unsigned int EscapeLength = 15;							// a Rice quotient of this many 1 bits is an escape code, and the full sample follows
+
+	// Return the maximum number of bits that one axis of one sample can take
+	constexpr unsigned int MaxBitsPerAxis(unsigned int resolution) noexcept { return EscapeLength + 1 + resolution; }
+
+	// Prediction and Rice parameter adaptation for one axis. The encoder and the decoder both use this so that they stay in step.
+	class AxisState
+	{
+	public:
+		void Reset() noexcept { numSeen = 0; errorSum = InitialErrorSum; errorCount = 1; }
+
+		int32_t Predict() const noexcept { return (numSeen >= 2) ? 2 * previous - beforePrevious : previous; }
+
+		// Return the Rice parameter, which is about log2 of the mean of recent zigzag-encoded errors
+		unsigned int GetRiceParameter(unsigned int resolution) const noexcept
+		{
+			unsigned int k = 0;
+			while ((errorCount << k) < errorSum && k < resolution)
+			{
+				++k;
+			}
+			return k;
+		}
+
+		void Update(int32_t val, uint32_t zigzagError) noexcept
+		{
+			beforePrevious = previous;
+			previous = val;
+			if (numSeen < 2)
+			{
+				++numSeen;
+			}
+			errorSum += zigzagError;
+			if (++errorCount == MaxErrorCount)
+			{
+				errorSum >>= 1;
+				errorCount >>= 1;
+			}
+		}
+
+		bool HaveSeenSample() const noexcept { return numSeen != 0; }
+
+	private:
+		static constexpr uint32_t InitialErrorSum = 16;
+		static constexpr uint32_t MaxErrorCount = 16;
+
+		int32_t previous;
+		int32_t beforePrevious;
+		uint32_t errorSum;
+		uint32_t errorCount;
+		unsigned int numSeen;
+	};
+
+	class Encoder
+	{
+	public:
+		void Start(uint16_t *p_data, size_t p_numWords, unsigned int p_numAxes, unsigned int p_resolution) noexcept;
+		bool HasRoomForSample() const noexcept { return bitsUsed + numAxes * MaxBitsPerAxis(resolution) <= numWords * 16; }
+		void AddValue(unsigned int axisIndex, int32_t val) noexcept;		// val is a signed value of 'resolution' bits, axisIndex counts only the enabled axes
+		size_t Finish() noexcept;											// flush any pending bits and return the number of words used
+		uint32_t GetBitsUsed() const noexcept { return bitsUsed; }
+
+	private:
+		void PutBits(uint32_t val, unsigned int numBits) noexcept
+		pre(numBits <= 16);
+
+		AxisState axisStates[MaxAxes];
+		uint16_t *data;
+		size_t numWords;
+		size_t wordsWritten;
+		uint32_t bitsPending;
+		unsigned int numBitsPending;
+		uint32_t bitsUsed;
+		unsigned int numAxes;
+		unsigned int resolution;
+	};
+
+	// Reference decoder. Decode 'numSamples' samples of 'numAxes' axes each into 'values', returning false if the data is malformed.
+	bool Decode(const uint16_t *data, size_t numWords, unsigned int numAxes, unsigned int resolution, unsigned int numSamples, int16_t *values) noexcept;
+}
+
+#endif /* SRC_COMMANDPROCESSING_ACCELEROMETERDELTACODEC_H_ */
@@ -17,13 +17,17 @@
 #include <CanMessageBuffer.h>
 #include <CAN/CanInterface.h>
 #include <CanMessageGenericParser.h>
+#include <Hardware/SavedSettings.h>
+#include "AccelerometerDeltaCodec.h"
+#include "AccelerometerDecimator.h"
 
-#define TEST_PACKING	0
+#define TEST_PACKING			0
+#define CHECK_DELTA_ENCODING	0				// set nonzero to decode each delta encoded packet and check that it matches the original samples
 
 constexpr uint16_t DefaultSamplingRate = 1000;
 constexpr uint8_t DefaultResolution = 10;
 
-constexpr size_t AccelerometerTaskStackWords = 130;
+constexpr size_t AccelerometerTaskStackWords = 140;
 static Task<AccelerometerTaskStackWords> *accelerometerTask;
 
 static LIS3DH *accelerometer = nullptr;
@@ -37,6 +41,64 @@ static volatile bool running = false;
 static uint8_t axisLookup[3];
 static bool axisInverted[3];
 
+// Projection of the enabled axes onto a direction, followed by decimation, so that we send a single reduced stream of samples
+constexpr unsigned int ProjectionFractionBits = 14;
+static bool projectionEnabled = false;
+static int32_t projectionDirection[3];							// unit vector in machine axes, scaled by 2^ProjectionFractionBits
+static AccelerometerDecimator decimator;
+
+// Lossless delta encoding of the samples, which lets us send more samples per packet
+constexpr unsigned int MaxEncodedSamplesInBuffer = 63;			// the numSamples field of the message is 6 bits wide
+static bool deltaEncoding = false;
+static AccelerometerDeltaCodec::Encoder encoder;
+static bool lastRunEncoded = false;
+static uint32_t lastRunSamples = 0;
+static uint32_t lastRunPackets = 0;
+static uint32_t lastRunEncodedBits = 0;
+static unsigned int lastRunNumAxes = 0;
+
+// The settings made through diagnostic tests as we keep them in EEPROM, so that they survive a reset of this board
+struct SavedAccelerometerSettings
+{
+	uint8_t deltaEncoding;
+	uint8_t decimationFactor;									// 0 if projection is off
+	uint8_t spare[2];
+	int32_t projectionDirection[3];
+};
+
+static void SaveSettings() noexcept
+{
+	SavedAccelerometerSettings saved;
+	memset(&saved, 0, sizeof(saved));
+	saved.deltaEncoding = (deltaEncoding) ? 1 : 0;
+	if (projectionEnabled)
+	{
+		saved.decimationFactor = decimator.GetFactor();
+		memcpy(saved.projectionDirection, projectionDirection, sizeof(projectionDirection));
+	}
+	SavedSettings::Save(SavedSettings::Block::accelerometer, &saved, sizeof(saved));
+}
+
+static void LoadSettings() noexcept
+{
+	SavedAccelerometerSettings saved;
+	if (SavedSettings::Load(SavedSettings::Block::accelerometer, &saved, sizeof(saved)))
+	{
+		deltaEncoding = (saved.deltaEncoding == 1);
+		if (saved.decimationFactor != 0 && decimator.Configure(saved.decimationFactor))
+		{
+			memcpy(projectionDirection, saved.projectionDirection, sizeof(projectionDirection));
+			projectionEnabled = true;
+		}
+	}
+}
+
+#if CHECK_DELTA_ENCODING
+static int16_t unencodedValues[MaxEncodedSamplesInBuffer * AccelerometerDeltaCodec::MaxAxes];
+static int16_t decodedValues[MaxEncodedSamplesInBuffer * AccelerometerDeltaCodec::MaxAxes];
+static uint32_t numDecodingErrors = 0;
+#endif
+
 [[noreturn]] void AccelerometerTaskCode(void*) noexcept
 {
 	for (;;)
@@ -47,7 +109,34 @@ static bool axisInverted[3];
 			// Collect and send the samples
 			CanMessageBuffer buf(nullptr);
 			CanMessageAccelerometerData& msg = *(buf.SetupStatusMessage<CanMessageAccelerometerData>(CanInterface::GetCanAddress(), CanInterface::GetCurrentMasterAddress()));
-			const unsigned int MaxSamplesInBuffer = msg.SetAxesAndResolution(axes, resolution);
+			const bool useProjection = projectionEnabled;
+			const unsigned int decimationFactor = (useProjection) ? decimator.GetFactor() : 1;
+			const int32_t maxSampleValue = (1 << (resolution - 1)) - 1;
+			int32_t projectionFactors[3];
+			if (useProjection)
+			{
+				// Get the projection factors of the enabled axes in the order that we read them
+				unsigned int numFactors = 0;
+				for (unsigned int axis = 0; axis < 3; ++axis)
+				{
+					if (axes & (1u << axis))
+					{
+						projectionFactors[numFactors++] = projectionDirection[axis];
+					}
+				}
+				decimator.Reset();
+			}
+
+			// When projecting we send a single stream of samples and report it as the X axis
+			const uint8_t axesSent = (useProjection) ? 0x01 : axes;
+			const unsigned int rawSamplesInBuffer = msg.SetAxesAndResolution(axesSent, resolution);
+			const bool useDeltaEncoding = deltaEncoding;
+			const unsigned int numAxes = __builtin_popcount(axesSent & 0x07);
+			const unsigned int maxSamplesInBuffer = (useDeltaEncoding) ? MaxEncodedSamplesInBuffer : rawSamplesInBuffer;
+			if (useDeltaEncoding)
+			{
+				encoder.Start(msg.data, ARRAY_SIZE(msg.data), numAxes, resolution);
+			}
 
 			unsigned int samplesSent = 0;
 			unsigned int samplesInBuffer = 0;
@@ -56,6 +145,9 @@ static bool axisInverted[3];
 			unsigned int bitsUsed = 0;
 			uint16_t bitsPending = 0;
 			bool overflowed = false;
+			uint32_t packetsSent = 0;
+			uint32_t encodedBits = 0;
+			bool discardFirstSample = true;
 
 #if TEST_PACKING
 			uint16_t pattern = 0;
@@ -67,81 +159,132 @@ static bool axisInverted[3];
 					uint16_t dataRate;
 					const uint16_t *data;
 					unsigned int samplesRead = accelerometer->CollectData(&data, dataRate, overflowed);
-					if (samplesSent + samplesInBuffer == 0 && samplesRead != 0)
+					if (discardFirstSample && samplesRead != 0)
 					{
 						// The first sample taken after waking up is inaccurate, so discard it
+						discardFirstSample = false;
 						--samplesRead;
 						data += 3;
 					}
-					if (samplesRead >= samplesWanted)
+					if (!useProjection && samplesRead >= samplesWanted)
 					{
 						samplesRead = samplesWanted;
 					}
 
-					while (samplesRead != 0)
+					while (samplesRead != 0 && samplesWanted != 0)
 					{
-						unsigned int samplesToCopy = min<unsigned int>(samplesRead, MaxSamplesInBuffer - samplesInBuffer);
-						while (samplesToCopy != 0)
+						// Extract the sample for each axis, sign-extended
+						int32_t values[3];
+						unsigned int numValues = 0;
+						for (unsigned int axis = 0; axis < 3; ++axis)
 						{
-							// Extract the required bits from the data and pack them into the CAN buffer
-							for (unsigned int axis = 0; axis < 3; ++axis)
+							if (axes & (1u << axis))
 							{
-								if (axes & (1u << axis))
-								{
-									uint16_t dataVal =
 #if TEST_PACKING
-														pattern++;
+								values[numValues] = pattern++;
 #else
-														data[axisLookup[axis]];
-									if (axisInverted[axis])
-									{
-										dataVal = (dataVal == 0x8000) ? ~dataVal : ~dataVal + 1;
-									}
-									dataVal >>= (16u - resolution);								// data from LIS3DH is left justified
-#endif
-									// Copy data for this axis
-									if (resolution == 16u)
-									{
-										msg.data[canDataIndex++] = dataVal;
-									}
-									else
-									{
-										const uint16_t val = dataVal;
-										bitsPending |= val << bitsUsed;
-										bitsUsed += resolution;
-										if (bitsUsed >= 16u)
-										{
-											msg.data[canDataIndex++] = bitsPending;
-											bitsUsed -= 16u;
-											bitsPending = val >> (resolution - bitsUsed);
-										}
-									}
+								uint16_t dataVal = data[axisLookup[axis]];
+								if (axisInverted[axis])
+								{
+									dataVal = (dataVal == 0x8000) ? ~dataVal : ~dataVal + 1;
 								}
+								values[numValues] = (int16_t)dataVal >> (16u - resolution);		// data from LIS3DH is left justified
+#endif
+								++numValues;
 							}
-							data += 3;
+						}
+						data += 3;
+						--samplesRead;
 
-							++samplesInBuffer;
-							--samplesToCopy;
-							--samplesWanted;
-							--samplesRead;
+						if (useProjection)
+						{
+							// Project the axes onto the configured direction and filter and decimate the result
+							int32_t projected = 0;
+							for (unsigned int i = 0; i < numValues; ++i)
+							{
+								projected += values[i] * projectionFactors[i];
+							}
+							projected = constrain<int32_t>(projected >> ProjectionFractionBits, -maxSampleValue, maxSampleValue);
+							if (!decimator.Process(projected, values[0]))
+							{
+								continue;
+							}
+							numValues = 1;
 						}
 
-						if (samplesInBuffer == MaxSamplesInBuffer || samplesWanted == 0)
+						// Pack the values into the CAN buffer
+						for (unsigned int axisIndex = 0; axisIndex < numValues; ++axisIndex)
+						{
+							if (useDeltaEncoding)
+							{
+								encoder.AddValue(axisIndex, values[axisIndex]);
+#if CHECK_DELTA_ENCODING
+								unencodedValues[samplesInBuffer * numAxes + axisIndex] = values[axisIndex];
+#endif
+							}
+							else if (resolution == 16u)
+							{
+								msg.data[canDataIndex++] = (uint16_t)values[axisIndex];
+							}
+							else
+							{
+								const uint16_t val = (uint16_t)values[axisIndex] & ((1u << resolution) - 1);
+								bitsPending |= val << bitsUsed;
+								bitsUsed += resolution;
+								if (bitsUsed >= 16u)
+								{
+									msg.data[canDataIndex++] = bitsPending;
+									bitsUsed -= 16u;
+									bitsPending = val >> (resolution - bitsUsed);
+								}
+							}
+						}
+
+						++samplesInBuffer;
+						--samplesWanted;
+
+						if (   samplesInBuffer == maxSamplesInBuffer
+							|| samplesWanted == 0
+							|| (useDeltaEncoding && !encoder.HasRoomForSample())
+						   )
 						{
 							// Send the buffer
-							if (bitsUsed != 0)
+							if (useDeltaEncoding)
+							{
+								encodedBits += encoder.GetBitsUsed();
+								canDataIndex = encoder.Finish();
+							}
+							else if (bitsUsed != 0)
 							{
 								msg.data[canDataIndex] = bitsPending;
 							}
 							msg.firstSampleNumber = samplesSent;
 							msg.numSamples = samplesInBuffer;
-							msg.actualSampleRate = dataRate;
+							msg.actualSampleRate = dataRate/decimationFactor;
 							msg.overflowed = overflowed;
 							msg.lastPacket = (samplesWanted == 0);
-							msg.zero = 0;
+							msg.zero = (useDeltaEncoding) ? 1 : 0;				// we use the spare bit to tell the main board that the data is delta encoded
 
-							buf.dataLength = msg.GetActualDataLength();
+							if (useDeltaEncoding)
+							{
+								// The length of the data depends on how well it compressed, not just on the number of samples
+								buf.dataLength = reinterpret_cast<const uint8_t*>(&msg.data[canDataIndex]) - reinterpret_cast<const uint8_t*>(&msg);
+#if CHECK_DELTA_ENCODING
+								if (   !AccelerometerDeltaCodec::Decode(msg.data, canDataIndex, numAxes, resolution, samplesInBuffer, decodedValues)
+									|| memcmp(decodedValues, unencodedValues, samplesInBuffer * numAxes * sizeof(decodedValues[0])) != 0
+								   )
+								{
+									++numDecodingErrors;
+								}
+#endif
+								encoder.Start(msg.data, ARRAY_SIZE(msg.data), numAxes, resolution);
+							}
+							else
+							{
+								buf.dataLength = msg.GetActualDataLength();
+							}
 							CanInterface::Send(&buf);
+							++packetsSent;
 
 							samplesSent += samplesInBuffer;
 							samplesInBuffer = 0;
@@ -155,6 +298,11 @@ static bool axisInverted[3];
 			}
 
 			accelerometer->StopCollecting();
+			lastRunEncoded = useDeltaEncoding;
+			lastRunSamples = samplesSent;
+			lastRunPackets = packetsSent;
+			lastRunEncodedBits = encodedBits;
+			lastRunNumAxes = numAxes;
 
 			// Wait for another command
 			running = false;
@@ -203,6 +351,7 @@ void AccelerometerHandler::Init() noexcept
 		temp->Configure(samplingRate, resolution);
 		accelerometer = temp;
 		(void)TranslateOrientation(orientation);
+		LoadSettings();
 		accelerometerTask = new Task<AccelerometerTaskStackWords>;
 		accelerometerTask->Create(AccelerometerTaskCode, "ACCEL", nullptr, TaskPriority::Accelerometer);
 	}
@@ -291,12 +440,87 @@ GCodeResult AccelerometerHandler::ProcessStartRequest(const CanMessageStartAccel
 	return GCodeResult::ok;
 }
 
+// Enable or disable delta encoding of the samples. The main board must be able to decode it.
+GCodeResult AccelerometerHandler::SetDeltaEncoding(bool enable, const StringRef& reply) noexcept
+{
+	if (running)
+	{
+		reply.printf("Accelerometer %u.0 is busy collecting data", CanInterface::GetCanAddress());
+		return GCodeResult::error;
+	}
+	deltaEncoding = enable;
+	SaveSettings();
+	return GCodeResult::ok;
+}
+
+// Set the direction to project the enabled axes onto and the decimation factor, or turn projection off if the factor is zero.
+// The direction is in machine axes, after the orientation has been applied. It need not be a unit vector.
+GCodeResult AccelerometerHandler::SetProjection(unsigned int factor, float x, float y, float z, const StringRef& reply) noexcept
+{
+	if (running)
+	{
+		reply.printf("Accelerometer %u.0 is busy collecting data", CanInterface::GetCanAddress());
+		return GCodeResult::error;
+	}
+
+	if (factor == 0)
+	{
+		projectionEnabled = false;
+		SaveSettings();
+		return GCodeResult::ok;
+	}
+
+	const float length = sqrtf(fsquare(x) + fsquare(y) + fsquare(z));
+	if (length < 0.001)
+	{
+		reply.copy("Projection direction must not be zero");
+		return GCodeResult::error;
+	}
+
+	if (!decimator.Configure(factor))
+	{
+		reply.printf("Decimation factor must be between 1 and %u", AccelerometerDecimator::MaxFactor);
+		return GCodeResult::error;
+	}
+
+	const float scale = (float)(1u << ProjectionFractionBits)/length;
+	projectionDirection[0] = lrintf(x * scale);
+	projectionDirection[1] = lrintf(y * scale);
+	projectionDirection[2] = lrintf(z * scale);
+	projectionEnabled = true;
+	SaveSettings();
+	return GCodeResult::ok;
+}
+
 void AccelerometerHandler::Diagnostics(const StringRef& reply) noexcept
 {
 	reply.lcatf("Accelerometer detected: %s", (accelerometer != nullptr) ? "yes" : "no");
 	if (accelerometer != nullptr)
 	{
-		reply.catf(", status: %02x", accelerometer->ReadStatus());
+		reply.catf(", status: %02x, delta encoding %s", accelerometer->ReadStatus(), (deltaEncoding) ? "on" : "off");
+		if (!SavedSettings::IsAvailable())
+		{
+			reply.cat(" (settings not saved, no EEPROM)");
+		}
+		if (projectionEnabled)
+		{
+			constexpr float ProjectionScale = 1.0/(float)(1u << ProjectionFractionBits);
+			reply.catf(", projecting onto (%.3f, %.3f, %.3f) decimated by %u",
+						(double)(projectionDirection[0] * ProjectionScale), (double)(projectionDirection[1] * ProjectionScale), (double)(projectionDirection[2] * ProjectionScale),
+							decimator.GetFactor());
+		}
+		if (lastRunSamples != 0)
+		{
+			reply.lcatf("Last run: %" PRIu32 " samples in %" PRIu32 " packets", lastRunSamples, lastRunPackets);
+			if (lastRunEncoded)
+			{
+				reply.catf(", %.1f bits per sample per axis encoded vs. %u unencoded",
+							(double)((float)lastRunEncodedBits/(float)(lastRunSamples * lastRunNumAxes)), resolution);
+			}
+		}
+#if CHECK_DELTA_ENCODING
+		reply.catf(", decoding errors %" PRIu32, numDecodingErrors);
+#endif
 	}
 }
 
@@ -23,6 +23,8 @@ namespace AccelerometerHandler
 	bool Present() noexcept;
 	GCodeResult ProcessConfigRequest(const CanMessageGeneric& msg, const StringRef& reply) noexcept;
 	GCodeResult ProcessStartRequest(const CanMessageStartAccelerometer& msg, const StringRef& reply) noexcept;
+	GCodeResult SetDeltaEncoding(bool enable, const StringRef& reply) noexcept;
+	GCodeResult SetProjection(unsigned int factor, float x, float y, float z, const StringRef& reply) noexcept;
 	void Diagnostics(const StringRef& reply) noexcept;
 };
 
@@ -21,6 +21,7 @@
 #include <Version.h>
 #include <AnalogIn.h>
 #include <Hardware/NonVolatileMemory.h>
+#include <Hardware/EventLog.h>
 #include <hpl_user_area.h>
 #include <cctype>				// for tolower()
 
@@ -579,6 +580,15 @@ static GCodeResult ProcessM915(const CanMessageGeneric& msg, const StringRef& re
 		}
 	}
 
+	{
+		uint16_t coolConf;
+		if (parser.GetUintParam('C', coolConf))			// the coolStep fields of COOLCONF (SEMIN, SEUP, SEMAX, SEDN, SEIMIN)
+		{
+			seen = true;
+			drivers.Iterate([coolConf](unsigned int drive, unsigned int) noexcept { SmartDrivers::SetRegister(drive, SmartDriverRegister::coolConf, coolConf); } );
+		}
+	}
+
 	if (!seen)
 	{
 		drivers.Iterate([&reply](unsigned int drive, unsigned int) noexcept
@@ -671,12 +681,17 @@ static GCodeResult GetInfo(const CanMessageReturnInfo& msg, const StringRef& rep
 		{
 			GenerateTestReport(reply);
 		}
+		else if (msg.param == 2)
+		{
+			EventLog::PrintRecent(reply);
+		}
 		else
 		{
 			extra = LastDiagnosticsPart;
 			reply.lcatf("%s (%s%s)", VersionText, IsoDate, TIME_SUFFIX);
 			const char *bootloaderVersionText = *reinterpret_cast<const char**>(0x20);		// offset of vectors.pvReservedM8
 			reply.lcatf("Bootloader ID: %s", (bootloaderVersionText == nullptr) ? "not available" : bootloaderVersionText);
+			Platform::AppendStartupTimes(reply);
 		}
 		break;
 
@@ -735,10 +750,16 @@ static GCodeResult GetInfo(const CanMessageReturnInfo& msg, const StringRef& rep
 				, driver, moveInstance->GetPosition(driver), (double)Platform::DriveStepsPerUnit(driver));
 # if HAS_SMART_DRIVERS
 			SmartDrivers::AppendDriverStatus(driver, reply);
+			Platform::AppendThermalDerating(driver, reply);
 # endif
 			reply.catf(", steps req %" PRIu32 " done %" PRIu32, DDA::stepsRequested[driver], DDA::stepsDone[driver]);
 			DDA::stepsRequested[driver] = DDA::stepsDone[driver] = 0;
 		}
+# if HAS_SMART_DRIVERS
+		Platform::AppendDriverFaultReports(reply);
+		reply.lcat("Automatic idle current");
+		Platform::AppendAutoIdleStatus(reply);
+# endif
 #endif
 		break;
 
@@ -773,6 +794,7 @@ static GCodeResult GetInfo(const CanMessageReturnInfo& msg, const StringRef& rep
 	case CanMessageReturnInfo::typeDiagnosticsPart0 + 6:
 		extra = LastDiagnosticsPart;
 		Heat::Diagnostics(reply);
+		FansManager::Diagnostics(reply);
 		CanInterface::Diagnostics(reply);
 #if 0
 		{
@@ -802,6 +824,7 @@ static GCodeResult GetInfo(const CanMessageReturnInfo& msg, const StringRef& rep
 #if SUPPORT_DRIVERS
 		FilamentMonitor::GetDiagnostics(reply);
 #endif
+		InputMonitor::Diagnostics(reply);
 		break;
 	}
 	return GCodeResult::ok;
@@ -31,18 +31,14 @@ constexpr float NEARLY_ABS_ZERO = -273.0;				// Celsius
 constexpr float ROOM_TEMPERATURE = 21.0;				// Celsius
 
 // Timeouts
-constexpr uint32_t FanCheckInterval = 500;				// Milliseconds
 constexpr uint32_t OpenLoadTimeout = 500;				// Milliseconds
-constexpr uint32_t MinimumWarningInterval = 4000;		// Milliseconds, must be at least as long as FanCheckInterval
+constexpr uint32_t MinimumWarningInterval = 4000;		// Milliseconds, must be at least as long as HeatSampleIntervalMillis
 constexpr uint32_t LogFlushInterval = 15000;			// Milliseconds
 constexpr uint32_t DriverCoolingTimeout = 4000;			// Milliseconds
 constexpr float DefaultMessageTimeout = 10.0;			// How long a message is displayed by default, in seconds
 
 constexpr uint32_t MinimumOpenLoadFullStepsPerSec = 20;
 
-// FanCheckInterval must be lower than MinimumWarningInterval to avoid giving driver over temperature warnings too soon when thermostatic control of electronics cooling fans is used
-static_assert(FanCheckInterval < MinimumWarningInterval, "FanCheckInterval too large");
-
 // Comms defaults
 constexpr unsigned int MAIN_BAUD_RATE = 115200;			// Default communication speed of the USB if needed
 constexpr unsigned int AUX_BAUD_RATE = 57600;			// Ditto - for auxiliary UART device
@@ -53,6 +49,9 @@ constexpr uint32_t SERIAL_MAIN_TIMEOUT = 1000;			// timeout in ms for sending da
 constexpr uint32_t HeatSampleIntervalMillis = 250;		// interval between taking temperature samples
 constexpr float HeatPwmAverageTime = 5.0;				// Seconds
 
+// Thermostatic fans are updated at HeatSampleIntervalMillis, which must be lower than MinimumWarningInterval to avoid giving driver over temperature warnings too soon when thermostatic control of electronics cooling fans is used
+static_assert(HeatSampleIntervalMillis < MinimumWarningInterval, "HeatSampleIntervalMillis too large");
+
 constexpr float TEMPERATURE_CLOSE_ENOUGH = 1.0;			// Celsius
 constexpr float TEMPERATURE_LOW_SO_DONT_CARE = 40.0;	// Celsius
 constexpr float HOT_ENOUGH_TO_EXTRUDE = 160.0;			// Celsius
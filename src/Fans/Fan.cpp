@@ -8,6 +8,8 @@
 #include "Fan.h"
 
 #include "CanMessageFormats.h"
+#include "Heating/Heat.h"
+#include "Heating/Sensors/TemperatureSensor.h"
 
 Fan::Fan(unsigned int fanNum)
 	: fanNumber(fanNum),
@@ -15,7 +17,9 @@ Fan::Fan(unsigned int fanNum)
 	  minVal(DefaultMinFanPwm),
 	  maxVal(1.0),										// 100% maximum fan speed
 	  blipTime(DefaultFanBlipTime),
-	  isConfigured(false)
+	  isConfigured(false),
+	  responseExponent(1.0), maxSlewRate(0.0),
+	  thermostaticDemand(0.0), whenDemandUpdated(0)
 {
 	triggerTemperatures[0] = triggerTemperatures[1] = DefaultHotEndFanTemperature;
 }
@@ -39,7 +43,85 @@ GCodeResult Fan::Configure(const CanMessageFanParameters& msg, const StringRef&
 void Fan::SetPwm(float speed)
 {
 	val = speed;
-	Refresh(true);
+	Refresh();
+}
+
+// Work out how fast a thermostatic fan should run from the temperatures of the sensors it monitors.
+// This is called by the heat task each time it has polled the sensors, so the fan responds to a new reading straight away. The main task applies the demand to the fan.
+void Fan::UpdateThermostaticDemand() noexcept
+{
+	const uint32_t now = millis();
+	float reqVal = 0.0;
+	bool fullOn = false;
+	const bool bangBangMode = (triggerTemperatures[1] <= triggerTemperatures[0]);
+	const float lastDemand = thermostaticDemand;
+	sensorsMonitored.Iterate
+	([&reqVal, &fullOn, bangBangMode, lastDemand, this](unsigned int sensorNum, unsigned int) noexcept
+		{
+			const auto sensor = Heat::FindSensor(sensorNum);
+			if (sensor.IsNotNull())
+			{
+				//TODO we used to turn the fan on if the associated heater was being tuned
+				float ht;
+				const TemperatureError err = sensor->GetLatestTemperature(ht);
+				if (err != TemperatureError::success || ht < BadLowTemperature || ht >= triggerTemperatures[1])
+				{
+					reqVal = max<float>(reqVal, (bangBangMode) ? max<float>(0.5, val) : 1.0);
+					fullOn = true;
+				}
+				else if (!bangBangMode && ht > triggerTemperatures[0])
+				{
+					// We already know that ht < triggerTemperatures[1], therefore unless we have NaNs it is safe to divide by (triggerTemperatures[1] - triggerTemperatures[0])
+					const float fraction = (ht - triggerTemperatures[0])/(triggerTemperatures[1] - triggerTemperatures[0]);
+					reqVal = max<float>(reqVal, (responseExponent == 1.0) ? fraction : powf(fraction, responseExponent));
+				}
+				else if (lastDemand > 0.0 && ht + ThermostatHysteresis > triggerTemperatures[0])		// if the fan is on, add a hysteresis before turning it off
+				{
+					const float minFanSpeed = (bangBangMode) ? max<float>(0.5, val) : minVal;
+					reqVal = constrain<float>(reqVal, minFanSpeed, maxVal);
+				}
+			}
+		}
+	);
+
+	// Limit how fast the proportional demand changes, except when a sensor is over temperature or faulty
+	if (maxSlewRate > 0.0 && !fullOn)
+	{
+		const float maxChange = maxSlewRate * (float)(now - whenDemandUpdated) * 0.001;
+		reqVal = constrain<float>(reqVal, lastDemand - maxChange, lastDemand + maxChange);
+	}
+	thermostaticDemand = max<float>(reqVal, 0.0);
+	whenDemandUpdated = now;
+}
+
+// Set the response curve exponent and the maximum rate of change of the proportional demand in fraction per second (zero means no limit)
+GCodeResult Fan::SetThermostaticResponse(float exponent, float slewRate, const StringRef& reply) noexcept
+{
+	if (exponent < 0.2 || exponent > 5.0 || slewRate < 0.0)
+	{
+		reply.copy("Fan response parameter out of range");
+		return GCodeResult::error;
+	}
+	responseExponent = exponent;
+	maxSlewRate = slewRate;
+	return GCodeResult::ok;
+}
+
+void Fan::AppendThermostaticResponse(const StringRef& reply) const noexcept
+{
+	reply.catf("Fan %u response exponent %.2f", fanNumber, (double)responseExponent);
+	if (maxSlewRate > 0.0)
+	{
+		reply.catf(", slew limit %.1f%%/sec", (double)(maxSlewRate * 100.0));
+	}
+	else
+	{
+		reply.cat(", no slew limit");
+	}
+	if (HasMonitoredSensors())
+	{
+		reply.catf(", demand %.1f%%", (double)(thermostaticDemand * 100.0));
+	}
 }
 
 // End
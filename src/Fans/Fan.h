@@ -20,7 +20,7 @@ class Fan
 public:
 	Fan(unsigned int fanNum);
 
-	virtual bool Check(bool checkSensors) = 0;				// update the fan PWM returning true if it is a thermostatic fan that is on
+	virtual bool Check() = 0;								// update the fan PWM returning true if it is a thermostatic fan that is on
 	virtual void SetPwmFrequency(PwmFrequency freq) = 0;
 	virtual bool IsEnabled() const = 0;
 	virtual int32_t GetRPM() = 0;
@@ -43,8 +43,12 @@ public:
 	void SetPwm(float speed);
 	bool HasMonitoredSensors() const { return !sensorsMonitored.IsEmpty(); }
 
+	void UpdateThermostaticDemand() noexcept;				// called by the heat task after it has polled the sensors
+	GCodeResult SetThermostaticResponse(float exponent, float slewRate, const StringRef& reply) noexcept;
+	void AppendThermostaticResponse(const StringRef& reply) const noexcept;
+
 protected:
-	virtual void Refresh(bool checkSensors) = 0;
+	virtual void Refresh() = 0;
 	virtual bool UpdateFanConfiguration(const StringRef& reply) = 0;
 
 	unsigned int fanNumber;
@@ -58,6 +62,12 @@ protected:
 	uint32_t blipTime;										// in milliseconds
 	SensorsBitmap sensorsMonitored;
 
+	// Variables used for thermostatic control
+	float responseExponent;									// the proportional demand is raised to this power, so values above 1.0 keep the fan quieter when only slightly warm
+	float maxSlewRate;										// maximum change in proportional demand per second, or zero for no limit
+	volatile float thermostaticDemand;						// written by the heat task, read by the main task
+	uint32_t whenDemandUpdated;
+
 	bool isConfigured;
 };
 
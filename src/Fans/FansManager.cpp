@@ -11,12 +11,77 @@
 #include "CanMessageFormats.h"
 #include "CanMessageGenericParser.h"
 #include "CAN/CanInterface.h"
+#include <Hardware/SavedSettings.h>
 
 #include <utility>
 
 static ReadWriteLock fansLock;
 static Fan *fans[MaxFans] = { 0 };
 
+// The thermostatic responses set by SetThermostaticResponse as we keep them in EEPROM. The main board creates the fans after each reset, so we apply the response when a fan is created.
+// Fans with the default response have no entry.
+constexpr size_t MaxSavedResponses = 8;
+struct SavedFanResponses
+{
+	uint8_t numResponses;
+	uint8_t spare;
+	struct
+	{
+		uint8_t fanNumber;
+		uint8_t spare;
+		uint16_t exponent;											// in units of 0.01
+		uint16_t slewRate;											// in units of 0.01 per second
+	} responses[MaxSavedResponses];
+};
+
+static_assert(sizeof(SavedFanResponses) <= SavedSettings::MaxDataLength);
+static SavedFanResponses savedResponses;
+
+// Return the index of the saved response for a fan, or the number of saved responses if there isn't one
+static size_t FindSavedResponse(uint32_t fanNum) noexcept
+{
+	size_t i = 0;
+	while (i < savedResponses.numResponses && savedResponses.responses[i].fanNumber != fanNum)
+	{
+		++i;
+	}
+	return i;
+}
+
+// Record the response of a fan. Return false if there is no room to save it. Must hold a read lock on the fans, so that a fan being created doesn't see a partly-updated record.
+static bool SaveResponse(uint32_t fanNum, float exponent, float slewRate) noexcept
+{
+	const size_t i = FindSavedResponse(fanNum);
+	const uint16_t savedExponent = (uint16_t)lrintf(exponent * 100.0);
+	const uint16_t savedSlewRate = (uint16_t)min<long>(lrintf(slewRate * 100.0), 0xFFFF);
+	bool ok = true;
+	if (savedExponent == 100 && savedSlewRate == 0)
+	{
+		if (i < savedResponses.numResponses)
+		{
+			--savedResponses.numResponses;
+			savedResponses.responses[i] = savedResponses.responses[savedResponses.numResponses];
+			memset(&savedResponses.responses[savedResponses.numResponses], 0, sizeof(savedResponses.responses[0]));
+		}
+	}
+	else if (i < MaxSavedResponses)
+	{
+		if (i == savedResponses.numResponses)
+		{
+			++savedResponses.numResponses;
+		}
+		savedResponses.responses[i].fanNumber = fanNum;
+		savedResponses.responses[i].exponent = savedExponent;
+		savedResponses.responses[i].slewRate = savedSlewRate;
+	}
+	else
+	{
+		ok = false;
+	}
+	SavedSettings::Save(SavedSettings::Block::fanResponses, &savedResponses, sizeof(savedResponses));
+	return ok;
+}
+
 // Retrieve the pointer to a fan, or nullptr if it doesn't exist.
 // Lock the fan system before calling this, so that the fan can't be deleted while we are accessing it.
 static ReadLockedPointer<Fan> FindFan(uint32_t fanNum)
@@ -35,17 +100,24 @@ static LocalFan *CreateLocalFan(uint32_t fanNum, const char *pinNames, PwmFreque
 		return nullptr;
 	}
 	newFan->SetPwmFrequency(freq);
+
+	const size_t i = FindSavedResponse(fanNum);
+	if (i < savedResponses.numResponses)
+	{
+		String<StringLength50> dummy;
+		(void)newFan->SetThermostaticResponse((float)savedResponses.responses[i].exponent * 0.01, (float)savedResponses.responses[i].slewRate * 0.01, dummy.GetRef());
+	}
 	return newFan;
 }
 
 // Check and if necessary update all fans. Return true if a thermostatic fan is running.
-bool FansManager::CheckFans(bool checkSensors)
+bool FansManager::CheckFans()
 {
 	ReadLocker lock(fansLock);
 	bool thermostaticFanRunning = false;
 	for (Fan* fan : fans)
 	{
-		if (fan != nullptr && fan->Check(checkSensors))
+		if (fan != nullptr && fan->Check())
 		{
 			thermostaticFanRunning = true;
 		}
@@ -53,6 +125,44 @@ bool FansManager::CheckFans(bool checkSensors)
 	return thermostaticFanRunning;
 }
 
+// Recalculate the demand of all thermostatic fans. Called by the heat task after it has polled the sensors.
+void FansManager::UpdateThermostaticFans() noexcept
+{
+	ReadLocker lock(fansLock);
+	for (Fan* fan : fans)
+	{
+		if (fan != nullptr && fan->HasMonitoredSensors())
+		{
+			fan->UpdateThermostaticDemand();
+		}
+	}
+}
+
+// Set the response curve exponent and slew limit of a thermostatic fan, or report them if the exponent is zero
+GCodeResult FansManager::SetThermostaticResponse(uint32_t fanNum, float exponent, float slewRate, const StringRef& reply) noexcept
+{
+	auto fan = FindFan(fanNum);
+	if (fan.IsNull())
+	{
+		reply.printf("Board %u doesn't have fan %u", CanInterface::GetCanAddress(), (unsigned int)fanNum);
+		return GCodeResult::error;
+	}
+
+	if (exponent == 0.0)
+	{
+		fan->AppendThermostaticResponse(reply);
+		return GCodeResult::ok;
+	}
+
+	const GCodeResult rslt = fan->SetThermostaticResponse(exponent, slewRate, reply);
+	if (rslt == GCodeResult::ok && !SaveResponse(fanNum, exponent, slewRate))
+	{
+		reply.copy("Fan response set but not saved, too many fans");
+		return GCodeResult::warning;
+	}
+	return rslt;
+}
+
 // This is called by M950 to create a fan or change its PWM frequency or report its port
 GCodeResult FansManager::ConfigureFanPort(const CanMessageGeneric& msg, const StringRef& reply)
 {
@@ -154,6 +264,32 @@ void FansManager::Init()
 	{
 		f = nullptr;
 	}
+
+	// Discard the saved responses if they don't make sense
+	if (!SavedSettings::Load(SavedSettings::Block::fanResponses, &savedResponses, sizeof(savedResponses)) || savedResponses.numResponses > MaxSavedResponses)
+	{
+		memset(&savedResponses, 0, sizeof(savedResponses));
+	}
+	for (size_t i = 0; i < savedResponses.numResponses; ++i)
+	{
+		if (savedResponses.responses[i].fanNumber >= MaxFans)
+		{
+			savedResponses.numResponses = 0;
+			break;
+		}
+	}
+}
+
+// Report the fan responses that we have saved
+void FansManager::Diagnostics(const StringRef& reply) noexcept
+{
+	ReadLocker lock(fansLock);
+	for (size_t i = 0; i < savedResponses.numResponses; ++i)
+	{
+		reply.lcatf("Fan %u response exponent %.2f, slew limit %.1f%%/sec%s",
+					savedResponses.responses[i].fanNumber, (double)((float)savedResponses.responses[i].exponent * 0.01), (double)savedResponses.responses[i].slewRate,
+						(SavedSettings::IsAvailable()) ? "" : " (not saved, no EEPROM)");
+	}
 }
 
 // Construct a fan RPM report message. Returns the number of fans reported in it.
@@ -21,11 +21,14 @@ class CanMessageFansReport;
 namespace FansManager
 {
 	void Init();
-	bool CheckFans(bool checkSensors);
+	bool CheckFans();
+	void UpdateThermostaticFans() noexcept;
+	GCodeResult SetThermostaticResponse(uint32_t fanNum, float exponent, float slewRate, const StringRef& reply) noexcept;
 	GCodeResult ConfigureFanPort(const CanMessageGeneric& msg, const StringRef& reply);
 	GCodeResult ConfigureFan(const CanMessageFanParameters& gb, const StringRef& reply);
 	GCodeResult SetFanSpeed(const CanMessageSetFanSpeed& msg, const StringRef& reply);
 	unsigned int PopulateFansReport(CanMessageFansReport& msg);
+	void Diagnostics(const StringRef& reply) noexcept;
 #if 0
 	void SetFanValue(uint32_t fanNum, float speed);
 #endif
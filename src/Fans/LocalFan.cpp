@@ -51,63 +51,27 @@ void LocalFan::SetHardwarePwm(float pwmVal)
 
 // Refresh the fan PWM
 // If you want make sure that the PWM is definitely updated, set lastPWM negative before calling this
-void LocalFan::Refresh(bool checkSensors)
+// For thermostatic fans we use the demand that the heat task calculated when it last polled the sensors
+void LocalFan::Refresh()
 {
-	float reqVal;
+	float reqVal = (sensorsMonitored.IsEmpty()) ? val : thermostaticDemand;
 #if 0 //TODO HAS_SMART_DRIVERS
 	uint32_t driverChannelsMonitored = 0;
-#endif
-
-	if (sensorsMonitored.IsEmpty())
-	{
-		reqVal = val;
-	}
-	else if (!checkSensors)
-	{
-		reqVal = lastVal;
-	}
-	else
-	{
-		reqVal = 0.0;
-		const bool bangBangMode = (triggerTemperatures[1] <= triggerTemperatures[0]);
-		sensorsMonitored.Iterate
-		([&reqVal, bangBangMode, this
-#if 0 // HAS_SMART_DRIVERS
-		  , &driverChannelsMonitored
-#endif
-		 ](unsigned int sensorNum, unsigned int) noexcept
+	sensorsMonitored.Iterate
+	([&driverChannelsMonitored](unsigned int sensorNum, unsigned int) noexcept
+		{
+			const auto sensor = Heat::FindSensor(sensorNum);
+			if (sensor.IsNotNull())
 			{
-				const auto sensor = Heat::FindSensor(sensorNum);
-				if (sensor.IsNotNull())
+				const int channel = sensor->GetSmartDriversChannel();
+				if (channel >= 0)
 				{
-					//TODO we used to turn the fan on if the associated heater was being tuned
-					float ht;
-					const TemperatureError err = sensor->GetLatestTemperature(ht);
-					if (err != TemperatureError::success || ht < BadLowTemperature || ht >= triggerTemperatures[1])
-					{
-						reqVal = max<float>(reqVal, (bangBangMode) ? max<float>(0.5, val) : 1.0);
-					}
-					else if (!bangBangMode && ht > triggerTemperatures[0])
-					{
-						// We already know that ht < triggerTemperatures[1], therefore unless we have NaNs it is safe to divide by (triggerTemperatures[1] - triggerTemperatures[0])
-						reqVal = max<float>(reqVal, (ht - triggerTemperatures[0])/(triggerTemperatures[1] - triggerTemperatures[0]));
-					}
-					else if (lastVal > 0.0 && ht + ThermostatHysteresis > triggerTemperatures[0])		// if the fan is on, add a hysteresis before turning it off
-					{
-						const float minFanSpeed = (bangBangMode) ? max<float>(0.5, val) : minVal;
-						reqVal = constrain<float>(reqVal, minFanSpeed, maxVal);
-					}
-#if 0 //HAS_SMART_DRIVERS
-					const int channel = sensor->GetSmartDriversChannel();
-					if (channel >= 0)
-					{
-						driverChannelsMonitored.SetBit((unsigned int)channel);
-					}
-#endif
+					driverChannelsMonitored.SetBit((unsigned int)channel);
 				}
 			}
-		);
-	}
+		}
+	);
+#endif
 
 	if (reqVal > 0.0)
 	{
@@ -150,14 +114,14 @@ void LocalFan::Refresh(bool checkSensors)
 
 bool LocalFan::UpdateFanConfiguration(const StringRef& reply)
 {
-	Refresh(true);
+	Refresh();
 	return true;
 }
 
 // Update the fan if necessary. Return true if it is a thermostatic fan and is running.
-bool LocalFan::Check(bool checkSensors)
+bool LocalFan::Check()
 {
-	Refresh(checkSensors);
+	Refresh();
 	return !sensorsMonitored.IsEmpty() && lastVal != 0.0;
 }
 
@@ -180,7 +144,7 @@ bool LocalFan::AssignPorts(const char *pinNames, const StringRef& reply)
 		tachoPort.AttachInterrupt(FanInterrupt, InterruptMode::falling, this);
 	}
 
-	Refresh(true);
+	Refresh();
 	return true;
 }
 
@@ -16,7 +16,7 @@ public:
 	LocalFan(unsigned int fanNum);
 	~LocalFan();
 
-	bool Check(bool checkSensors) override;					// update the fan PWM returning true if it is a thermostatic fan that is on
+	bool Check() override;					// update the fan PWM returning true if it is a thermostatic fan that is on
 	bool IsEnabled() const override { return port.IsValid(); }
 	void SetPwmFrequency(PwmFrequency freq) override { port.SetFrequency(freq); }
 	int32_t GetRPM() override;
@@ -27,7 +27,7 @@ public:
 	void Interrupt();
 
 protected:
-	void Refresh(bool checkSensors) override;
+	void Refresh() override;
 	bool UpdateFanConfiguration(const StringRef& reply) override;
 
 private:
@@ -25,7 +25,19 @@ constexpr uint16_t ControlRegisterValue = (1 << 15)		// write
 										| (1 << 4)		// internal reference
 										| (0 << 2);		// sequencer not used
 
+// Control register value to make the ADC convert channels 0 to 7 in turn on successive frames
+constexpr uint16_t SequencerControlRegisterValue = ControlRegisterValue
+												| (7 << 10)		// last channel in the consecutive sequence
+												| (1 << 3)		// SEQ1 = 1, SEQ2 = 0: consecutive sequence from channel 0
+												| (0 << 2);
+
+constexpr unsigned int NumChannels = 8;
+constexpr uint32_t MaxReadingAge = 5;							// maximum age in milliseconds of a cached reading before we scan the ADC again
+
 static SharedSpiClient *device = nullptr;
+static volatile uint16_t readings[NumChannels];					// the most recent reading from each channel
+static volatile uint32_t whenLastScanned = 0;
+static bool scannedOk = false;
 
 // Write and read 16 bits to the ADC
 static uint16_t AdcTransfer(uint16_t dataOut) noexcept
@@ -56,47 +68,70 @@ void ExtendedAnalog::Init(SharedSpiDevice& sharedSpi) noexcept
 
 	(void)AdcTransfer((1 << 15) | (2 << 13) | (3 << 11) | (3 << 9) | (3 << 7) | (3 << 5));
 
-	for (uint16_t chan = 0; chan < 8; ++chan)
-	{
-		digitalWrite(ExtendedAdcCsPin, true);
-		delayMicroseconds(1);
-		digitalWrite(ExtendedAdcCsPin, false);
-		delayMicroseconds(1);
+	digitalWrite(ExtendedAdcCsPin, true);
+	delayMicroseconds(1);
+	digitalWrite(ExtendedAdcCsPin, false);
+	delayMicroseconds(1);
 
-		// Write the control register, select single ended input for this channel, internal reference, sequencer not used
-		(void)AdcTransfer(ControlRegisterValue | (chan << 10));
-	}
+	// Write the control register, select single ended inputs, internal reference, and the sequencer to convert channels 0 to 7 in turn
+	(void)AdcTransfer(SequencerControlRegisterValue);
 
 	device->Deselect();
 	delayMicroseconds(1);
+
+	for (volatile uint16_t& r : readings)
+	{
+		r = 0x8000;
+	}
 }
 
-// Read an ADC channel
-uint16_t ExtendedAnalog::AnalogIn(unsigned int chan) noexcept
+// Convert all the channels in a single burst of transfers and cache the results. Return true if successful.
+// The sequencer supplies the next channel on each frame and each result is tagged with its channel number, so we don't need to write to the ADC.
+static bool ScanChannels() noexcept
 {
-	if (device->Select(200))
+	if (!device->Select(200))
 	{
-		delayMicroseconds(1);
-		(void)AdcTransfer(ControlRegisterValue | ((chan & 7) << 10));	// set channel to sample next
+		return false;
+	}
 
-		// We need to pulse CS low and high again to get the ADC to convert the channel we just selected
+	uint16_t newReadings[NumChannels];
+	uint8_t channelsSeen = 0;
+	for (unsigned int i = 0; i < NumChannels; ++i)
+	{
+		// Each frame must start with a falling edge on CS
 		digitalWrite(ExtendedAdcCsPin, true);
-		delayMicroseconds(1);
 		digitalWrite(ExtendedAdcCsPin, false);
-		delayMicroseconds(1);
+		const uint8_t wb[2] = { 0, 0 };
+		uint8_t rb[2];
+		device->TransceivePacket(wb, rb, 2);
+		const uint16_t rslt = ((uint16_t)rb[0] << 8) | rb[1];
+		const unsigned int chan = rslt >> 13;
+		static_assert(AnalogIn::AdcBits >= 14);
+		newReadings[chan] = (rslt & 8191) << (AnalogIn::AdcBits - 13 - 1);	// extend 13-bit result to the required number of bits, leaving the top bit clear
+		channelsSeen |= 1u << chan;
+	}
+	device->Deselect();
 
-		const uint16_t rslt = AdcTransfer(0);
-		device->Deselect();
-		delayMicroseconds(1);
-		if ((rslt >> 13) == chan)										// if the result is for the channel we asked for
+	for (unsigned int chan = 0; chan < NumChannels; ++chan)
+	{
+		readings[chan] = (channelsSeen & (1u << chan)) ? newReadings[chan] : 0x8001;	// 0x8001 indicates channel reading error
+	}
+	whenLastScanned = millis();
+	return true;
+}
+
+// Read an ADC channel. We return the cached reading unless it is too old, in which case we scan all the channels again.
+uint16_t ExtendedAnalog::AnalogIn(unsigned int chan) noexcept
+{
+	if (!scannedOk || millis() - whenLastScanned > MaxReadingAge)
+	{
+		scannedOk = ScanChannels();
+		if (!scannedOk)
 		{
-			static_assert(AnalogIn::AdcBits >= 14);
-			return (rslt & 8191) << (AnalogIn::AdcBits - 13 - 1);		// extend 13-bit result to the required number of bits, leaving the top bit clear
+			return 0x8000;												// indicate select error
 		}
-		return 0x8001;													// indicate channel reading error
 	}
-
-	return 0x8000;														// indicate select error
+	return readings[chan & 7];
 }
 
 #endif
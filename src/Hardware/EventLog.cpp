@@ -0,0 +1,165 @@
+/*
+ * EventLog.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#include "EventLog.h"
+#include <Hardware/EEPROM.h>
+#include <RTOSIface/RTOSIface.h>
+
+namespace EventLog
+{
+	struct EventRecord
+	{
+		uint32_t sequence;					// sequence number, 0xFFFFFFFF if the slot has never been written
+		uint32_t upTime;					// milliseconds since the board was reset
+		uint16_t type;
+		uint16_t param16;
+		uint32_t param32;
+
+		bool IsEmpty() const noexcept { return sequence == 0xFFFFFFFF; }
+	};
+
+	static_assert(sizeof(EventRecord) == 16);
+
+	constexpr uint32_t LogOffset = 1024;									// offset in EEPROM, must be clear of the 512 bytes used by NonVolatileMemory
+	constexpr uint32_t LogSize = 1024;
+	constexpr unsigned int NumRecords = LogSize/sizeof(EventRecord);
+#if SAMC21
+	constexpr unsigned int RecordsPerRow = (NVMCTRL_ROW_PAGES * NVMCTRL_PAGE_SIZE)/sizeof(EventRecord);	// records that get erased together
+	static_assert(LogOffset % (NVMCTRL_ROW_PAGES * NVMCTRL_PAGE_SIZE) == 0);
+#endif
+	constexpr unsigned int MaxPendingEvents = 4;
+	constexpr unsigned int MaxEventsPrinted = 8;
+
+	static const char *const EventNames[] = { "?", "boot", "heater fault", "under voltage", "CAN bus off", "hiccups", "driver derated", "CAN timing fallback" };
+
+	static bool enabled = false;
+	static unsigned int nextSlot = 0;
+	static uint32_t nextSequence = 0;
+
+	static EventRecord pendingEvents[MaxPendingEvents];
+	static volatile unsigned int numPendingEvents = 0;
+	static unsigned int eventsDropped = 0;
+
+	static bool ReadRecord(unsigned int slot, EventRecord& rec) noexcept
+	{
+		return EEPROM::Read(reinterpret_cast<char*>(&rec), LogOffset + slot * sizeof(EventRecord), sizeof(EventRecord));
+	}
+
+	static void WriteRecord(const EventRecord& rec) noexcept
+	{
+#if SAMC21
+		// When we move into a new flash row, write the whole row with the rest of the slots empty. That costs one erase,
+		// and the remaining records in the row can then be written without erasing it again.
+		if (nextSlot % RecordsPerRow == 0)
+		{
+			EventRecord rowBuffer[RecordsPerRow];
+			memset(rowBuffer, 0xFF, sizeof(rowBuffer));
+			rowBuffer[0] = rec;
+			(void)EEPROM::Write(reinterpret_cast<const char*>(rowBuffer), LogOffset + nextSlot * sizeof(EventRecord), sizeof(rowBuffer));
+		}
+		else
+#endif
+		{
+			(void)EEPROM::Write(reinterpret_cast<const char*>(&rec), LogOffset + nextSlot * sizeof(EventRecord), sizeof(EventRecord));
+		}
+		nextSlot = (nextSlot + 1) % NumRecords;
+	}
+}
+
+// Find the newest record so that we know where to write the next one, then log that we have started
+void EventLog::Init() noexcept
+{
+	if (EEPROM::GetSize() < LogOffset + LogSize)
+	{
+		return;																// EEPROM not configured, e.g. a debug build
+	}
+
+	enabled = true;
+	bool found = false;
+	uint32_t newestSequence = 0;
+	for (unsigned int slot = 0; slot < NumRecords; ++slot)
+	{
+		EventRecord rec;
+		if (ReadRecord(slot, rec) && !rec.IsEmpty() && (!found || (int32_t)(rec.sequence - newestSequence) > 0))
+		{
+			found = true;
+			newestSequence = rec.sequence;
+			nextSlot = (slot + 1) % NumRecords;
+		}
+	}
+	nextSequence = (found) ? newestSequence + 1 : 0;
+
+	Record(EventType::boot, RSTC->RCAUSE.reg);
+}
+
+// Queue an event to be written to EEPROM. Must not be called from an ISR.
+void EventLog::Record(EventType type, uint16_t param16, uint32_t param32) noexcept
+{
+	if (enabled)
+	{
+		TaskCriticalSectionLocker lock;
+		if (numPendingEvents < MaxPendingEvents)
+		{
+			EventRecord& rec = pendingEvents[numPendingEvents];
+			rec.upTime = millis();
+			rec.type = (uint16_t)type;
+			rec.param16 = param16;
+			rec.param32 = param32;
+			numPendingEvents = numPendingEvents + 1;
+		}
+		else
+		{
+			++eventsDropped;
+		}
+	}
+}
+
+// Write any queued events to EEPROM. Called only by the main task.
+void EventLog::Spin() noexcept
+{
+	while (numPendingEvents != 0)
+	{
+		EventRecord rec;
+		{
+			TaskCriticalSectionLocker lock;
+			rec = pendingEvents[0];
+			for (unsigned int i = 1; i < numPendingEvents; ++i)
+			{
+				pendingEvents[i - 1] = pendingEvents[i];
+			}
+			numPendingEvents = numPendingEvents - 1;
+		}
+		rec.sequence = nextSequence++;
+		WriteRecord(rec);
+	}
+}
+
+// Append the most recent events to the reply, newest first
+void EventLog::PrintRecent(const StringRef& reply) noexcept
+{
+	if (!enabled)
+	{
+		reply.copy("Event log not available");
+		return;
+	}
+
+	reply.printf("Event log (newest first), sequence %" PRIu32 ", dropped %u:", nextSequence, eventsDropped);
+	unsigned int slot = nextSlot;
+	for (unsigned int i = 0; i < MaxEventsPrinted; ++i)
+	{
+		slot = (slot + NumRecords - 1) % NumRecords;
+		EventRecord rec;
+		if (!ReadRecord(slot, rec) || rec.IsEmpty())
+		{
+			break;
+		}
+		reply.lcatf("%" PRIu32 " at %" PRIu32 "ms: %s %u %" PRIu32,
+					rec.sequence, rec.upTime, (rec.type < ARRAY_SIZE(EventNames)) ? EventNames[rec.type] : EventNames[0], rec.param16, rec.param32);
+	}
+}
+
+// End
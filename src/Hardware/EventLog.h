@@ -0,0 +1,37 @@
+/*
+ * EventLog.h
+ *
+ * Circular log of significant events, kept in EEPROM so that it survives a reset
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef SRC_HARDWARE_EVENTLOG_H_
+#define SRC_HARDWARE_EVENTLOG_H_
+
+#include <RepRapFirmware.h>
+
+// The log lives in the emulated EEPROM after the area used by NonVolatileMemory. It is written as a ring of fixed-size records, each tagged with a sequence number
+// that continues across resets, so every part of the area gets written equally often and we can find the newest record when we start up.
+// Record() may be called from any task but not from an ISR. It just queues the event; the main task writes it to EEPROM when it calls Spin().
+
+namespace EventLog
+{
+	enum class EventType : uint16_t
+	{
+		boot = 1,							// param16 = reset cause register
+		heaterFault,						// param16 = heater number
+		underVoltage,						// param32 = VIN in millivolts
+		canBusOff,							// param32 = number of bus off events
+		hiccups,							// param32 = number of hiccups since the last hiccup event was logged
+		driverDerated,						// param16 = driver number
+		canTimingFallback,					// param32 = error count when we went back to the previous CAN timing
+	};
+
+	void Init() noexcept;
+	void Spin() noexcept;
+	void Record(EventType type, uint16_t param16 = 0, uint32_t param32 = 0) noexcept;
+	void PrintRecent(const StringRef& reply) noexcept;
+}
+
+#endif /* SRC_HARDWARE_EVENTLOG_H_ */
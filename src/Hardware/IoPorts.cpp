@@ -429,71 +429,166 @@ void IoPort::AppendPinName(const StringRef& str) const
 	}
 }
 
-// Function to look up a pin name pass back the corresponding index into the pin table
-// On this platform, the mapping from pin names to pins is fixed, so this is a simple lookup
-/*static*/ bool IoPort::LookupPinName(const char*pn, Pin& returnedPin, bool& hardwareInverted, bool& pullupAlways)
+// Hashed index of the pin names, built at compile time from the pin table so that looking up a pin name doesn't need a string compare against every alias of every pin.
+// Each slot holds the logical pin number plus one (zero if the slot is empty) in the low byte and the index of the alias within that pin's names in the high byte.
+namespace PinNameIndex
 {
-	if (StringEqualsIgnoreCase(pn, NoPinName))
+	// Find alias number 'aliasNumber' in a comma-separated list of pin names, returning false if there are not that many.
+	// Pins that can't be assigned have null names.
+	constexpr bool GetAlias(const char *names, unsigned int aliasNumber, const char *& name, size_t& length, bool& hwInverted, bool& pullupAlways) noexcept
 	{
-		returnedPin = NoPin;
-		hardwareInverted = false;
-		return true;
-	}
+		if (names == nullptr)
+		{
+			return false;
+		}
 
-	for (size_t lp = 0; lp < ARRAY_SIZE(PinTable); ++lp)
-	{
-#ifdef TOOL1LC
-		// Pin io3.in aka PA1 is not available in board version 1.0 and earlier
-		if (Platform::GetBoardVariant() == 0 && lp == PortAPin(1)) { continue; }
-#endif
-		const char *q = PinTable[lp].pinNames;
-		while (*q != 0)
+		for (;;)
 		{
-			// Try the next alias in the list of names for this pin
-			bool hwInverted = false, pullAlways = false;
+			hwInverted = pullupAlways = false;
 			for (;;)
 			{
-				if (*q == '!')
+				if (*names == '!')
 				{
 					hwInverted = true;
 				}
-				else if (*q == '^')
+				else if (*names == '^')
 				{
-					pullAlways = true;
+					pullupAlways = true;
 				}
 				else
 				{
 					break;
 				}
-				++q;
+				++names;
 			}
-			const char *p = pn;
-			while (*q != ',' && *q != 0 && *p == *q)
+
+			name = names;
+			length = 0;
+			while (names[length] != 0 && names[length] != ',')
 			{
-				++p;
-				++q;
+				++length;
 			}
-			if (*p == 0 && (*q == 0 || *q == ','))
+
+			if (aliasNumber == 0)
 			{
-				// Found a match
-				returnedPin = (Pin)lp;
-				hardwareInverted = hwInverted;
-				pullupAlways = pullAlways;
-				return true;
+				return length != 0;
 			}
+			if (names[length] == 0)
+			{
+				return false;
+			}
+			--aliasNumber;
+			names += length + 1;
+		}
+	}
 
-			// Skip to the start of the next alias
-			while (*q != 0 && *q != ',')
+	// FNV-1a hash
+	constexpr uint32_t Hash(const char *name, size_t length) noexcept
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < length; ++i)
+		{
+			hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	constexpr size_t CountAliases() noexcept
+	{
+		size_t count = 0;
+		for (const PinDescription& pd : PinTable)
+		{
+			const char *name = nullptr;
+			size_t length = 0;
+			bool hwInverted = false, pullupAlways = false;
+			for (unsigned int aliasNumber = 0; GetAlias(pd.pinNames, aliasNumber, name, length, hwInverted, pullupAlways); ++aliasNumber)
 			{
-				++q;
+				++count;
 			}
-			if (*q == ',')
+		}
+		return count;
+	}
+
+	constexpr size_t NumAliases = CountAliases();
+
+	// The table size is a power of 2 at least twice the number of aliases, to keep probe sequences short
+	constexpr size_t TableSize = []() noexcept -> size_t
+	{
+		size_t size = 16;
+		while (size < 2 * NumAliases) { size <<= 1; }
+		return size;
+	}();
+
+	static_assert(ARRAY_SIZE(PinTable) < 255);
+
+	struct Table
+	{
+		uint16_t slots[TableSize];
+	};
+
+	constexpr Table Build() noexcept
+	{
+		Table table = {};
+		for (size_t lp = 0; lp < ARRAY_SIZE(PinTable); ++lp)
+		{
+			const char *name = nullptr;
+			size_t length = 0;
+			bool hwInverted = false, pullupAlways = false;
+			for (unsigned int aliasNumber = 0; GetAlias(PinTable[lp].pinNames, aliasNumber, name, length, hwInverted, pullupAlways); ++aliasNumber)
 			{
-				++q;
+				size_t slot = Hash(name, length) & (TableSize - 1);
+				while (table.slots[slot] != 0)
+				{
+					slot = (slot + 1) & (TableSize - 1);
+				}
+				table.slots[slot] = (uint16_t)((lp + 1) | (aliasNumber << 8));
 			}
 		}
+		return table;
+	}
+
+	constexpr Table table = Build();
+}
+
+// Function to look up a pin name pass back the corresponding index into the pin table
+// On this platform, the mapping from pin names to pins is fixed, so we use the hashed index of pin names
+/*static*/ bool IoPort::LookupPinName(const char*pn, Pin& returnedPin, bool& hardwareInverted, bool& pullupAlways)
+{
+	if (StringEqualsIgnoreCase(pn, NoPinName))
+	{
+		returnedPin = NoPin;
+		hardwareInverted = false;
+		return true;
+	}
+
+	const size_t pnLength = strlen(pn);
+	for (size_t slot = PinNameIndex::Hash(pn, pnLength) & (PinNameIndex::TableSize - 1); ; slot = (slot + 1) & (PinNameIndex::TableSize - 1))
+	{
+		const uint16_t entry = PinNameIndex::table.slots[slot];
+		if (entry == 0)
+		{
+			return false;
+		}
+
+		const size_t lp = (entry & 0xFF) - 1;
+#ifdef TOOL1LC
+		// Pin io3.in aka PA1 is not available in board version 1.0 and earlier
+		if (Platform::GetBoardVariant() == 0 && lp == PortAPin(1)) { continue; }
+#endif
+		const char *name;
+		size_t length;
+		bool hwInverted, pullAlways;
+		if (   PinNameIndex::GetAlias(PinTable[lp].pinNames, entry >> 8, name, length, hwInverted, pullAlways)
+			&& length == pnLength && memcmp(name, pn, length) == 0
+		   )
+		{
+			// Found a match
+			returnedPin = (Pin)lp;
+			hardwareInverted = hwInverted;
+			pullupAlways = pullAlways;
+			return true;
+		}
 	}
-	return false;
 }
 
 /*static*/ const char* IoPort::TranslatePinAccess(PinAccess access)
@@ -90,7 +90,7 @@ bool EEPROM::Write(const char *data, uint32_t offset, uint32_t length)
 		offset += thisLength;
 		uint32_t pageBuffer[FlashRowSize/4];											// buffer to hold the data we may need to erase
 		memcpy(static_cast<void*>(pageBuffer), reinterpret_cast<const void *>(RWWEEEaddess + rowStartOffset), FlashRowSize);
-		char *bufp = reinterpret_cast<char *>(pageBuffer) + thisOffset;
+		char *bufp = reinterpret_cast<char *>(pageBuffer);
 		bool eraseNeeded = false;														// true if we are changing any bits from 0 to 1
 		uint32_t writesNeeded = 0;														// bitmap of pages in the row that need to be written
 		while (thisLength != 0)
@@ -99,7 +99,7 @@ bool EEPROM::Write(const char *data, uint32_t offset, uint32_t length)
 			{
 				eraseNeeded = true;
 			}
-			else if (*bufp != *data)
+			else if (bufp[thisOffset] != *data)
 			{
 				writesNeeded |= 1 << (thisOffset/FLASH_PAGE_SIZE);
 			}
@@ -0,0 +1,107 @@
+/*
+ * SavedSettings.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#include "SavedSettings.h"
+#include <Hardware/EEPROM.h>
+#include <RTOSIface/RTOSIface.h>
+
+namespace SavedSettings
+{
+	struct SettingsRecord
+	{
+		uint16_t magic;						// MagicValue plus the block number, anything else means the block has never been saved
+		uint8_t length;						// the length of the data that was saved
+		uint8_t spare;
+		uint8_t data[MaxDataLength];
+
+		static constexpr uint16_t MagicValue = 0x5E70;
+	};
+
+	static_assert(sizeof(SettingsRecord) == 64);
+
+	constexpr uint32_t SettingsOffset = 512;								// offset in EEPROM, just after the 512 bytes used by NonVolatileMemory
+	constexpr size_t NumBlocks = (size_t)Block::numBlocks;
+	static_assert(SettingsOffset + NumBlocks * sizeof(SettingsRecord) <= 1024);	// the event log starts at 1024
+
+	static bool available = false;
+	static SettingsRecord records[NumBlocks];
+	static volatile uint32_t blocksToWrite = 0;
+}
+
+void SavedSettings::Init() noexcept
+{
+	if (EEPROM::GetSize() < SettingsOffset + sizeof(records))
+	{
+		return;																// EEPROM not configured, e.g. a debug build
+	}
+
+	for (size_t i = 0; i < NumBlocks; ++i)
+	{
+		if (!EEPROM::Read(reinterpret_cast<char*>(&records[i]), SettingsOffset + i * sizeof(SettingsRecord), sizeof(SettingsRecord))
+			|| records[i].magic != SettingsRecord::MagicValue + i)
+		{
+			records[i].magic = 0;
+		}
+	}
+	available = true;
+}
+
+bool SavedSettings::IsAvailable() noexcept
+{
+	return available;
+}
+
+// Copy a block of saved settings. Return false if they have not been saved or were saved with a different length.
+bool SavedSettings::Load(Block block, void *data, size_t length) noexcept
+{
+	const SettingsRecord& rec = records[(size_t)block];
+	TaskCriticalSectionLocker lock;
+	if (!available || rec.magic != SettingsRecord::MagicValue + (uint16_t)block || rec.length != length)
+	{
+		return false;
+	}
+	memcpy(data, rec.data, length);
+	return true;
+}
+
+// Update a block of saved settings. The main task writes it to EEPROM later. Must not be called from an ISR.
+void SavedSettings::Save(Block block, const void *data, size_t length) noexcept
+{
+	if (available && length <= MaxDataLength)
+	{
+		SettingsRecord& rec = records[(size_t)block];
+		TaskCriticalSectionLocker lock;
+		if (rec.magic != SettingsRecord::MagicValue + (uint16_t)block || rec.length != length || memcmp(rec.data, data, length) != 0)
+		{
+			rec.magic = SettingsRecord::MagicValue + (uint16_t)block;
+			rec.length = length;
+			rec.spare = 0xFF;
+			memcpy(rec.data, data, length);
+			memset(rec.data + length, 0xFF, MaxDataLength - length);
+			blocksToWrite = blocksToWrite | (1u << (size_t)block);
+		}
+	}
+}
+
+// Write any changed blocks to EEPROM. Called only by the main task.
+void SavedSettings::Spin() noexcept
+{
+	while (blocksToWrite != 0)
+	{
+		SettingsRecord rec;
+		size_t block;
+		{
+			TaskCriticalSectionLocker lock;
+			block = LowestSetBit(blocksToWrite);
+			blocksToWrite = blocksToWrite & ~(1u << block);
+			rec = records[block];
+		}
+		(void)EEPROM::Write(reinterpret_cast<const char*>(&rec), SettingsOffset + block * sizeof(SettingsRecord), sizeof(SettingsRecord));
+	}
+}
+
+// End
@@ -0,0 +1,39 @@
+/*
+ * SavedSettings.h
+ *
+ * Settings that the main board sends us that must survive a reset, kept in EEPROM
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#ifndef SRC_HARDWARE_SAVEDSETTINGS_H_
+#define SRC_HARDWARE_SAVEDSETTINGS_H_
+
+#include <RepRapFirmware.h>
+
+// The settings live in the emulated EEPROM between the area used by NonVolatileMemory and the event log. Each module that saves settings has its own fixed-size block.
+// Save() may be called from any task but not from an ISR. It just updates the copy in RAM; the main task writes changed blocks to EEPROM when it calls Spin().
+
+namespace SavedSettings
+{
+	enum class Block : uint8_t
+	{
+		coupledHeaters = 0,
+		heaterPower,
+		inputMonitorModes,
+		accelerometer,
+		fanResponses,
+		autoIdle,
+		numBlocks
+	};
+
+	constexpr size_t MaxDataLength = 60;
+
+	void Init() noexcept;
+	void Spin() noexcept;
+	bool Load(Block block, void *data, size_t length) noexcept;			// returns false if the block has not been saved with this length
+	void Save(Block block, const void *data, size_t length) noexcept;
+	bool IsAvailable() noexcept;
+}
+
+#endif /* SRC_HARDWARE_SAVEDSETTINGS_H_ */
@@ -24,6 +24,7 @@ public:
 	void Deselect() const;
 	bool TransceivePacket(const uint8_t *tx_data, uint8_t *rx_data, size_t len) const;
 	void SetCsPin(Pin p) { csPin = p; }
+	void SetClockFrequency(uint32_t freq) { clockFrequency = freq; }					// takes effect the next time we select the device
 
 private:
 	SharedSpiDevice& device;
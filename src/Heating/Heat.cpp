@@ -27,6 +27,7 @@ Licence: GPL
 #include <CanMessageBuffer.h>
 #include "CAN/CanInterface.h"
 #include "Fans/FansManager.h"
+#include <Hardware/SavedSettings.h>
 
 #if SUPPORT_DHT_SENSOR
 # include "Sensors/DhtSensor.h"
@@ -66,6 +67,60 @@ namespace Heat
 	static unsigned int lastSensorsFound = 0;					// for diagnostics
 	static uint32_t heatTaskLoopTime = 0;						// for diagnostics
 
+	// Heaters that heat each other significantly, for example the zones of a multi-zone bed, can be put in a coupled group.
+	// Each heater in the group then subtracts from its own PWM the heat that it is receiving from the others.
+	constexpr size_t MaxCoupledHeaters = 4;
+	constexpr float MaxCouplingFactor = 0.5;					// the highest fraction of another heater's PWM that we believe can reach a heater
+	constexpr uint32_t MinCouplingIdentificationSamples = (60 * SecondsToMillis)/HeatSampleIntervalMillis;	// how long tuning must run for us to estimate coupling
+	constexpr float CouplingIdentificationMaxOtherPwm = 0.01;	// the other heaters in the group must stay off while we identify the coupling
+
+	static uint8_t coupledHeaters[MaxCoupledHeaters];			// the heater numbers in the coupled group
+	static size_t numCoupledHeaters = 0;
+	static float couplingFactors[MaxCoupledHeaters][MaxCoupledHeaters];	// couplingFactors[i][j] is the fraction of the PWM of heater j that acts like PWM of heater i
+
+	// The coupled group as we keep it in EEPROM, so that it survives a reset
+	struct SavedCoupledHeaters
+	{
+		uint8_t numHeaters;
+		uint8_t heaters[MaxCoupledHeaters];
+		uint8_t spare[3];
+		uint16_t factors[MaxCoupledHeaters][MaxCoupledHeaters];		// in units of 0.0001
+	};
+
+	// Variables used to identify the coupling while a heater in the group is being tuned
+	static int couplingSourceIndex = -1;						// the index in the coupled group of the heater being tuned, or -1
+	static float couplingStartTemperatures[MaxCoupledHeaters];
+	static float couplingPwmSum;
+	static uint32_t couplingSamples;
+	static bool couplingOthersStayedOff;
+
+#if HAS_VOLTAGE_MONITOR
+	// Heaters whose resistance is known share the board power budget, in order of priority and then of temperature error
+	static float powerBudget = 0.0;								// the power available to the heaters in watts, or 0 if there is no budget
+	static uint8_t budgetOrder[MaxHeaters];						// the order in which the heaters are given power
+	static uint32_t budgetCycles = 0;							// for diagnostics
+	static uint32_t budgetLimitedCycles = 0;					// for diagnostics
+
+	// The power budget as we keep it in EEPROM. The heaters don't exist until the main board configures them, so we apply their parameters when they are created.
+	constexpr size_t MaxSavedBudgetHeaters = 6;
+	struct SavedHeaterPower
+	{
+		uint32_t budget;											// in units of 0.1W
+		uint8_t numHeaters;
+		uint8_t spare[3];
+		struct
+		{
+			uint8_t heater;
+			uint8_t priority;
+			uint16_t spare;
+			uint32_t resistance;									// in milliohms
+		} heaters[MaxSavedBudgetHeaters];
+	};
+
+	static_assert(sizeof(SavedHeaterPower) <= SavedSettings::MaxDataLength);
+	static SavedHeaterPower savedHeaterPower;					// also our record of the heater parameters, so that we can report them
+#endif
+
 	static ReadLockedPointer<Heater> FindHeater(int heater)
 	{
 		ReadLocker locker(heatersLock);
@@ -131,6 +186,277 @@ namespace Heat
 		reply.printf("Board %u does not have heater %u", CanInterface::GetCanAddress(), heater);
 		return GCodeResult::error;
 	}
+
+	// Return the index of a heater in the coupled group, or -1 if it isn't in the group
+	static int GetCoupledHeaterIndex(unsigned int heater) noexcept
+	{
+		for (size_t i = 0; i < numCoupledHeaters; ++i)
+		{
+			if (coupledHeaters[i] == heater)
+			{
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	// Save the coupled group and the coupling factors so that they survive a reset
+	static void SaveCoupledHeaters() noexcept
+	{
+		SavedCoupledHeaters saved;
+		memset(&saved, 0, sizeof(saved));
+		saved.numHeaters = numCoupledHeaters;
+		for (size_t i = 0; i < numCoupledHeaters; ++i)
+		{
+			saved.heaters[i] = coupledHeaters[i];
+			for (size_t j = 0; j < numCoupledHeaters; ++j)
+			{
+				saved.factors[i][j] = (uint16_t)lrintf(couplingFactors[i][j] * 10000.0);
+			}
+		}
+		SavedSettings::Save(SavedSettings::Block::coupledHeaters, &saved, sizeof(saved));
+	}
+
+	// Restore the coupled group. The heaters themselves don't exist until the main board configures them, but the heat task skips missing heaters.
+	static void LoadCoupledHeaters() noexcept
+	{
+		SavedCoupledHeaters saved;
+		if (SavedSettings::Load(SavedSettings::Block::coupledHeaters, &saved, sizeof(saved)) && saved.numHeaters <= MaxCoupledHeaters)
+		{
+			for (size_t i = 0; i < saved.numHeaters; ++i)
+			{
+				if (saved.heaters[i] >= MaxHeaters)
+				{
+					return;
+				}
+			}
+			numCoupledHeaters = saved.numHeaters;
+			for (size_t i = 0; i < numCoupledHeaters; ++i)
+			{
+				coupledHeaters[i] = saved.heaters[i];
+				for (size_t j = 0; j < numCoupledHeaters; ++j)
+				{
+					couplingFactors[i][j] = min<float>((float)saved.factors[i][j] * 0.0001, MaxCouplingFactor);
+				}
+			}
+		}
+	}
+
+#if HAS_VOLTAGE_MONITOR
+	// Restore the power budget. Discard the saved heater parameters if they don't make sense.
+	static void LoadHeaterPower() noexcept
+	{
+		if (!SavedSettings::Load(SavedSettings::Block::heaterPower, &savedHeaterPower, sizeof(savedHeaterPower)) || savedHeaterPower.numHeaters > MaxSavedBudgetHeaters)
+		{
+			memset(&savedHeaterPower, 0, sizeof(savedHeaterPower));
+		}
+		for (size_t i = 0; i < savedHeaterPower.numHeaters; ++i)
+		{
+			if (savedHeaterPower.heaters[i].heater >= MaxHeaters)
+			{
+				savedHeaterPower.numHeaters = 0;
+				break;
+			}
+		}
+		powerBudget = (float)savedHeaterPower.budget * 0.1;
+	}
+
+	// Record the power budget parameters of a heater. Return false if there is no room to save them.
+	static bool SaveHeaterPowerParameters(unsigned int heater, float resistance, unsigned int priority) noexcept
+	{
+		size_t i = 0;
+		while (i < savedHeaterPower.numHeaters && savedHeaterPower.heaters[i].heater != heater)
+		{
+			++i;
+		}
+
+		bool ok = true;
+		if (resistance == 0.0)
+		{
+			if (i < savedHeaterPower.numHeaters)
+			{
+				--savedHeaterPower.numHeaters;
+				savedHeaterPower.heaters[i] = savedHeaterPower.heaters[savedHeaterPower.numHeaters];
+				memset(&savedHeaterPower.heaters[savedHeaterPower.numHeaters], 0, sizeof(savedHeaterPower.heaters[0]));
+			}
+		}
+		else if (i < MaxSavedBudgetHeaters)
+		{
+			if (i == savedHeaterPower.numHeaters)
+			{
+				++savedHeaterPower.numHeaters;
+			}
+			savedHeaterPower.heaters[i].heater = heater;
+			savedHeaterPower.heaters[i].priority = priority;
+			savedHeaterPower.heaters[i].resistance = (uint32_t)lrintf(resistance * 1000.0);
+		}
+		else
+		{
+			ok = false;
+		}
+		SavedSettings::Save(SavedSettings::Block::heaterPower, &savedHeaterPower, sizeof(savedHeaterPower));
+		return ok;
+	}
+
+	// Give a newly-created heater the power budget parameters that were saved for it. Must write-lock the heaters lock before calling this.
+	// SaveHeaterPowerParameters is called with the read lock held, so this doesn't see a partly-updated record.
+	static void ApplySavedHeaterPower(unsigned int heater) noexcept
+	{
+		for (size_t i = 0; i < savedHeaterPower.numHeaters; ++i)
+		{
+			if (savedHeaterPower.heaters[i].heater == heater)
+			{
+				heaters[heater]->SetPowerBudgetParameters((float)savedHeaterPower.heaters[i].resistance * 0.001, savedHeaterPower.heaters[i].priority);
+				break;
+			}
+		}
+	}
+#endif
+
+	// Tell each heater in the coupled group how much heat it is getting from the others. Must read-lock the heaters lock before calling this.
+	// We use the average PWM because the heat reaches the neighbouring zones slowly, so the instantaneous PWM is of no use.
+	static void UpdateCoupledPwms() noexcept
+	{
+		for (size_t i = 0; i < numCoupledHeaters; ++i)
+		{
+			Heater * const h = heaters[coupledHeaters[i]];
+			if (h != nullptr)
+			{
+				float coupledPwm = 0.0;
+				for (size_t j = 0; j < numCoupledHeaters; ++j)
+				{
+					const Heater * const source = heaters[coupledHeaters[j]];
+					if (j != i && source != nullptr)
+					{
+						coupledPwm += couplingFactors[i][j] * source->GetAveragePWM();
+					}
+				}
+				h->SetCoupledPwm(coupledPwm);
+			}
+		}
+	}
+
+#if HAS_VOLTAGE_MONITOR
+	// Share out the power budget between the heaters. Must read-lock the heaters lock before calling this.
+	// We go by the PWM that each heater asked for on the previous cycle, which is close enough given the heater time constants.
+	// Heaters being tuned come first so that the tuning results are not spoilt.
+	static void AllocatePowerBudget() noexcept
+	{
+		if (powerBudget <= 0.0)
+		{
+			return;
+		}
+
+		// Sort the heaters in the budget into the order in which they get power
+		size_t numBudgeted = 0;
+		uint64_t sorted = 0;
+		for (;;)
+		{
+			int best = -1;
+			unsigned int bestPriority = 0;
+			float bestError = 0.0;
+			for (size_t heater = 0; heater < MaxHeaters; ++heater)
+			{
+				const Heater * const h = heaters[heater];
+				if (h != nullptr && h->GetResistance() > 0.0 && (sorted & ((uint64_t)1u << heater)) == 0)
+				{
+					const unsigned int priority = (h->IsTuning()) ? 0 : h->GetPowerPriority() + 1;
+					const float error = fabsf(h->GetTargetTemperature() - h->GetTemperature());
+					if (best < 0 || priority < bestPriority || (priority == bestPriority && error > bestError))
+					{
+						best = (int)heater;
+						bestPriority = priority;
+						bestError = error;
+					}
+				}
+			}
+			if (best < 0)
+			{
+				break;
+			}
+			sorted |= (uint64_t)1u << best;
+			budgetOrder[numBudgeted++] = (uint8_t)best;
+		}
+
+		// Give each heater the power it asked for until the budget runs out, then share out what is left so that heaters can increase their power
+		const float vinSquared = fsquare(Platform::GetCurrentVinVoltage());
+		if (numBudgeted == 0 || vinSquared < 1.0)
+		{
+			return;
+		}
+
+		float remainingPower = powerBudget;
+		bool limited = false;
+		for (size_t i = 0; i < numBudgeted; ++i)
+		{
+			Heater * const h = heaters[budgetOrder[i]];
+			const float requestedPower = vinSquared * h->GetRequestedPwm()/h->GetResistance();
+			const float grantedPower = min<float>(requestedPower, remainingPower);
+			if (grantedPower < requestedPower)
+			{
+				limited = true;
+			}
+			remainingPower -= grantedPower;
+			h->SetPwmLimit(grantedPower * h->GetResistance()/vinSquared);
+		}
+
+		for (size_t i = 0; i < numBudgeted && remainingPower > 0.0; ++i)
+		{
+			Heater * const h = heaters[budgetOrder[i]];
+			const float maxPower = vinSquared/h->GetResistance();
+			const float grantedPower = h->GetRequestedPwm() * maxPower;
+			const float extraPower = min<float>(max<float>(maxPower - grantedPower, 0.0), remainingPower);
+			remainingPower -= extraPower;
+			h->SetPwmLimit(min<float>((grantedPower + extraPower)/maxPower, 1.0));
+		}
+
+		++budgetCycles;
+		if (limited)
+		{
+			++budgetLimitedCycles;
+		}
+	}
+#endif
+
+	// Called on each temperature sample while a heater in the coupled group is being tuned. Must read-lock the heaters lock before calling this.
+	static void AccumulateCouplingData(float tunedHeaterPwm) noexcept
+	{
+		couplingPwmSum += tunedHeaterPwm;
+		++couplingSamples;
+		for (size_t i = 0; i < numCoupledHeaters; ++i)
+		{
+			const Heater * const h = heaters[coupledHeaters[i]];
+			if ((int)i != couplingSourceIndex && h != nullptr && h->GetAveragePWM() > CouplingIdentificationMaxOtherPwm)
+			{
+				couplingOthersStayedOff = false;
+			}
+		}
+	}
+
+	// Called when tuning of a heater in the coupled group has finished. Must read-lock the heaters lock before calling this.
+	// Work out how much of the tuned heater's heat reached each of the other heaters in the group.
+	// The temperature of each other heater follows dT/dt = heatingRate * coupledPwm - coolingRate * (T - ambient), where ambient is its starting temperature.
+	static void FinishCouplingIdentification() noexcept
+	{
+		if (couplingOthersStayedOff && couplingSamples >= MinCouplingIdentificationSamples && couplingPwmSum > 0.0)
+		{
+			const float elapsedTime = (float)(couplingSamples * HeatSampleIntervalMillis) * MillisToSeconds;
+			const float meanSourcePwm = couplingPwmSum/couplingSamples;
+			for (size_t i = 0; i < numCoupledHeaters; ++i)
+			{
+				const Heater * const h = heaters[coupledHeaters[i]];
+				if ((int)i != couplingSourceIndex && h != nullptr && h->GetModel().IsEnabled())
+				{
+					const FopDt& model = h->GetModel();
+					const float temperatureRise = h->GetTemperature() - couplingStartTemperatures[i];
+					const float crossHeatingRate = temperatureRise/elapsedTime + model.GetCoolingRateFanOff() * temperatureRise * 0.5;
+					couplingFactors[i][couplingSourceIndex] = constrain<float>(crossHeatingRate/(model.GetHeatingRate() * meanSourcePwm), 0.0, MaxCouplingFactor);
+				}
+			}
+		}
+		couplingSourceIndex = -1;
+		SaveCoupledHeaters();
+	}
 }
 
 // Is the heater enabled?
@@ -162,6 +488,11 @@ void Heat::Init()
 	retractionMinTemp = HOT_ENOUGH_TO_RETRACT;
 	coldExtrude = false;
 
+	LoadCoupledHeaters();
+#if HAS_VOLTAGE_MONITOR
+	LoadHeaterPower();
+#endif
+
 	heaterTask = new Task<HeaterTaskStackWords>;
 	heaterTask->Create(Heat::TaskLoop, "HEAT", nullptr, TaskPriority::HeatPriority);
 }
@@ -215,6 +546,10 @@ void Heat::Exit()
 			// Spin the heaters
 			{
 				ReadLocker lock(heatersLock);
+				UpdateCoupledPwms();
+#if HAS_VOLTAGE_MONITOR
+				AllocatePowerBudget();
+#endif
 				for (Heater *h : heaters)
 				{
 					if (h != nullptr)
@@ -224,6 +559,9 @@ void Heat::Exit()
 				}
 			}
 
+			// Now that we have fresh temperature readings, update the thermostatic fans
+			FansManager::UpdateThermostaticFans();
+
 			// Broadcast our sensor temperatures
 			lastSensorsBroadcastWhich = sensorTempsMsg->whichSensors;	// for diagnostics
 			lastSensorsBroadcastWhen = millis();						// for diagnostics
@@ -241,6 +579,10 @@ void Heat::Exit()
 			const auto h = FindHeater(heaterBeingTuned);
 			if (h.IsNotNull() && h->IsTuning())
 			{
+				if (couplingSourceIndex >= 0)
+				{
+					AccumulateCouplingData(h->GetAveragePWM());
+				}
 				auto msg = buf.SetupStatusMessage<CanMessageHeaterTuningReport>(CanInterface::GetCanAddress(), CanInterface::GetCurrentMasterAddress());
 				if (LocalHeater::GetTuningCycleData(*msg))
 				{
@@ -250,6 +592,10 @@ void Heat::Exit()
 			}
 			else
 			{
+				if (couplingSourceIndex >= 0)
+				{
+					FinishCouplingIdentification();
+				}
 				heaterBeingTuned = -1;
 			}
 		}
@@ -343,6 +689,9 @@ GCodeResult Heat::ConfigureHeater(const CanMessageGeneric& msg, const StringRef&
 		if (rslt == GCodeResult::ok || rslt == GCodeResult::warning)
 		{
 			heaters[heater] = newHeater;
+#if HAS_VOLTAGE_MONITOR
+			ApplySavedHeaterPower(heater);
+#endif
 		}
 		else
 		{
@@ -529,7 +878,25 @@ GCodeResult Heat::TuningCommand(const CanMessageHeaterTuningCommand& msg, const
 		return UnknownHeater(msg.heaterNumber, reply);
 	}
 	heaterBeingTuned = (int)msg.heaterNumber;			// setting this is OK even if we are stopping or fail to start tuning, because we check it in the heater task loop
-	return h->TuningCommand(msg, reply);
+	const GCodeResult rslt = h->TuningCommand(msg, reply);
+	if (msg.on && rslt == GCodeResult::ok)
+	{
+		// If the heater is in the coupled group, record the temperatures of the others so that we can see how much tuning heats them
+		couplingSourceIndex = GetCoupledHeaterIndex(msg.heaterNumber);
+		if (couplingSourceIndex >= 0)
+		{
+			// We already hold a read lock on the heaters because of h
+			for (size_t i = 0; i < numCoupledHeaters; ++i)
+			{
+				const Heater * const other = heaters[coupledHeaters[i]];
+				couplingStartTemperatures[i] = (other != nullptr) ? other->GetTemperature() : BadErrorTemperature;
+			}
+			couplingPwmSum = 0.0;
+			couplingSamples = 0;
+			couplingOthersStayedOff = true;
+		}
+	}
+	return rslt;
 }
 
 GCodeResult Heat::FeedForward(const CanMessageHeaterFeedForward& msg, const StringRef& reply)
@@ -538,6 +905,178 @@ GCodeResult Heat::FeedForward(const CanMessageHeaterFeedForward& msg, const Stri
 	return (h.IsNull()) ? UnknownHeater(msg.heaterNumber, reply) : h->FeedForwardAdjustment(msg.fanPwmAdjustment, msg.extrusionAdjustment);
 }
 
+// Set up the coupled heater group. Changing the group clears the coupling factors, which are then found by tuning each heater in the group in turn.
+GCodeResult Heat::ConfigureCoupledHeaters(uint32_t heaterBitmap, const StringRef& reply)
+{
+	{
+		WriteLocker lock(heatersLock);
+
+		for (size_t i = 0; i < numCoupledHeaters; ++i)
+		{
+			if (heaters[coupledHeaters[i]] != nullptr)
+			{
+				heaters[coupledHeaters[i]]->SetCoupledPwm(0.0);
+			}
+		}
+		numCoupledHeaters = 0;
+		couplingSourceIndex = -1;
+
+		for (size_t heater = 0; heater < min<size_t>(MaxHeaters, 32); ++heater)
+		{
+			if ((heaterBitmap & (1u << heater)) != 0)
+			{
+				if (heaters[heater] == nullptr)
+				{
+					numCoupledHeaters = 0;
+					SaveCoupledHeaters();
+					return UnknownHeater(heater, reply);
+				}
+				if (numCoupledHeaters == MaxCoupledHeaters)
+				{
+					numCoupledHeaters = 0;
+					SaveCoupledHeaters();
+					reply.printf("Too many heaters in coupled group, maximum is %u", (unsigned int)MaxCoupledHeaters);
+					return GCodeResult::error;
+				}
+				coupledHeaters[numCoupledHeaters++] = heater;
+			}
+		}
+
+		for (auto& row : couplingFactors)
+		{
+			for (float& f : row)
+			{
+				f = 0.0;
+			}
+		}
+		SaveCoupledHeaters();
+	}
+
+	AppendCoupledHeaters(reply);
+	return GCodeResult::ok;
+}
+
+// Set the fraction of the PWM of sourceHeater that acts like PWM of heater
+GCodeResult Heat::SetCouplingFactor(unsigned int heater, unsigned int sourceHeater, float factor, const StringRef& reply)
+{
+	{
+		WriteLocker lock(heatersLock);
+
+		const int index = GetCoupledHeaterIndex(heater);
+		const int sourceIndex = GetCoupledHeaterIndex(sourceHeater);
+		if (index < 0 || sourceIndex < 0 || index == sourceIndex)
+		{
+			reply.copy("Heaters must be two different members of the coupled group");
+			return GCodeResult::error;
+		}
+		if (factor < 0.0 || factor > MaxCouplingFactor)
+		{
+			reply.printf("Coupling factor must be between 0 and %.2f", (double)MaxCouplingFactor);
+			return GCodeResult::error;
+		}
+		couplingFactors[index][sourceIndex] = factor;
+		SaveCoupledHeaters();
+	}
+	AppendCoupledHeaters(reply);
+	return GCodeResult::ok;
+}
+
+#if HAS_VOLTAGE_MONITOR
+
+// Set the resistance of a heater so that it is included in the power budget, or set it to zero to exclude it
+GCodeResult Heat::SetHeaterPowerParameters(unsigned int heater, float resistance, unsigned int priority, const StringRef& reply)
+{
+	const auto h = FindHeater(heater);
+	if (h.IsNull())
+	{
+		return UnknownHeater(heater, reply);
+	}
+	if (resistance < 0.0 || priority > 255)
+	{
+		reply.copy("Bad resistance or priority");
+		return GCodeResult::error;
+	}
+	h->SetPowerBudgetParameters(resistance, priority);
+	const bool saved = SaveHeaterPowerParameters(heater, resistance, priority);
+	if (resistance == 0.0)
+	{
+		h->SetPwmLimit(1.0);
+		reply.printf("Heater %u is not in the power budget", heater);
+	}
+	else
+	{
+		reply.printf("Heater %u resistance %.2f ohms, power budget priority %u", heater, (double)resistance, priority);
+	}
+	if (!saved)
+	{
+		reply.cat(" (not saved, too many heaters)");
+		return GCodeResult::warning;
+	}
+	return GCodeResult::ok;
+}
+
+// Set the total power available to the heaters in the budget, or zero for no limit
+GCodeResult Heat::SetPowerBudget(float watts, const StringRef& reply)
+{
+	if (watts < 0.0)
+	{
+		reply.copy("Bad power budget");
+		return GCodeResult::error;
+	}
+
+	{
+		ReadLocker lock(heatersLock);
+		powerBudget = watts;
+		if (watts == 0.0)
+		{
+			for (Heater *h : heaters)
+			{
+				if (h != nullptr)
+				{
+					h->SetPwmLimit(1.0);
+				}
+			}
+		}
+	}
+	budgetCycles = budgetLimitedCycles = 0;
+	savedHeaterPower.budget = (uint32_t)lrintf(watts * 10.0);
+	SavedSettings::Save(SavedSettings::Block::heaterPower, &savedHeaterPower, sizeof(savedHeaterPower));
+
+	if (watts == 0.0)
+	{
+		reply.copy("No heater power budget");
+	}
+	else
+	{
+		reply.printf("Heater power budget %.1fW", (double)watts);
+	}
+	return GCodeResult::ok;
+}
+
+#endif
+
+void Heat::AppendCoupledHeaters(const StringRef& reply)
+{
+	if (numCoupledHeaters == 0)
+	{
+		reply.lcat("No coupled heaters");
+		return;
+	}
+
+	reply.lcat((SavedSettings::IsAvailable()) ? "Coupled heaters" : "Coupled heaters (not saved, no EEPROM)");
+	for (size_t i = 0; i < numCoupledHeaters; ++i)
+	{
+		reply.lcatf("heater %u:", coupledHeaters[i]);
+		for (size_t j = 0; j < numCoupledHeaters; ++j)
+		{
+			if (j != i)
+			{
+				reply.catf(" %.3f from %u", (double)couplingFactors[i][j], coupledHeaters[j]);
+			}
+		}
+	}
+}
+
 float Heat::GetAveragePWM(size_t heater)
 {
 	const auto h = FindHeater(heater);
@@ -590,6 +1129,23 @@ void Heat::Diagnostics(const StringRef& reply)
 {
 	reply.lcatf("Last sensors broadcast 0x%08" PRIx64 " found %u %" PRIu32 " ticks ago, loop time %" PRIu32,
 					lastSensorsBroadcastWhich, lastSensorsFound, millis() - lastSensorsBroadcastWhen, heatTaskLoopTime);
+	if (numCoupledHeaters != 0)
+	{
+		AppendCoupledHeaters(reply);
+	}
+#if HAS_VOLTAGE_MONITOR
+	if (powerBudget > 0.0)
+	{
+		reply.lcatf("Heater power budget %.1fW%s, limited power in %" PRIu32 " of %" PRIu32 " cycles",
+						(double)powerBudget, (SavedSettings::IsAvailable()) ? "" : " (not saved, no EEPROM)", budgetLimitedCycles, budgetCycles);
+		budgetCycles = budgetLimitedCycles = 0;
+	}
+	for (size_t i = 0; i < savedHeaterPower.numHeaters; ++i)
+	{
+		reply.lcatf("Heater %u resistance %.2f ohms, power budget priority %u",
+						savedHeaterPower.heaters[i].heater, (double)savedHeaterPower.heaters[i].resistance * 0.001, savedHeaterPower.heaters[i].priority);
+	}
+#endif
 }
 
 // End
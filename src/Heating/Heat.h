@@ -52,6 +52,17 @@ namespace Heat
 	GCodeResult TuningCommand(const CanMessageHeaterTuningCommand& msg, const StringRef& reply);
 	GCodeResult FeedForward(const CanMessageHeaterFeedForward& msg, const StringRef& reply);
 
+	// Methods that relate to the coupled heater group
+	GCodeResult ConfigureCoupledHeaters(uint32_t heaterBitmap, const StringRef& reply);
+	GCodeResult SetCouplingFactor(unsigned int heater, unsigned int sourceHeater, float factor, const StringRef& reply);
+	void AppendCoupledHeaters(const StringRef& reply);
+
+#if HAS_VOLTAGE_MONITOR
+	// Methods that relate to the heater power budget
+	GCodeResult SetHeaterPowerParameters(unsigned int heater, float resistance, unsigned int priority, const StringRef& reply);
+	GCodeResult SetPowerBudget(float watts, const StringRef& reply);
+#endif
+
 	float GetAveragePWM(size_t heater)							// Return the running average PWM to the heater as a fraction in [0, 1].
 	pre(heater < NumTotalHeaters);
 
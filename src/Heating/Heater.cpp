@@ -12,7 +12,8 @@
 
 Heater::Heater(unsigned int num)
 	: heaterNumber(num), sensorNumber(-1), requestedTemperature(0.0),
-	  maxTempExcursion(DefaultMaxTempExcursion), maxHeatingFaultTime(DefaultMaxHeatingFaultTime)
+	  maxTempExcursion(DefaultMaxTempExcursion), maxHeatingFaultTime(DefaultMaxHeatingFaultTime), coupledPwm(0.0),
+	  resistance(0.0), requestedPwm(0.0), pwmLimit(1.0), powerPriority(0)
 {
 }
 
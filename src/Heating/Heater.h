@@ -71,6 +71,16 @@ public:
 	bool IsTuning() const { return GetMode() >= HeaterMode::firstTuningMode; }
 	uint8_t GetModeByte() const { return (uint8_t)GetMode(); }
 
+	void SetCoupledPwm(float pwm) noexcept { coupledPwm = pwm; }	// Set the equivalent PWM that this heater receives from other heaters in its coupled group
+
+	// Power budget support
+	void SetPowerBudgetParameters(float r, unsigned int pri) noexcept { resistance = r; powerPriority = pri; }
+	float GetResistance() const noexcept { return resistance; }	// Get the heater resistance in ohms, or 0 if not known
+	unsigned int GetPowerPriority() const noexcept { return powerPriority; }
+	float GetRequestedPwm() const noexcept { return requestedPwm; }	// Get the PWM that the heater asked for last time, before the power budget limit was applied
+	void SetPwmLimit(float limit) noexcept { pwmLimit = limit; }
+	float GetTargetTemperature() const noexcept { return requestedTemperature; }
+
 protected:
 	enum class HeaterMode : uint8_t
 	{
@@ -102,7 +112,8 @@ protected:
 	void SetSensorNumber(int sn) noexcept { sensorNumber = sn; }
 	float GetMaxTemperatureExcursion() const noexcept { return maxTempExcursion; }
 	float GetMaxHeatingFaultTime() const noexcept { return maxHeatingFaultTime; }
-	float GetTargetTemperature() const noexcept { return requestedTemperature; }
+	float GetCoupledPwm() const noexcept { return coupledPwm; }
+	float ApplyPwmLimit(float pwm) noexcept { requestedPwm = pwm; return min<float>(pwm, pwmLimit); }
 	GCodeResult SetModel(float phr, float pcr, float pcrChange, float td, float maxPwm, float voltage, bool usePid, bool inverted, const StringRef& reply) noexcept;	// Set the process model
 
 	HeaterMonitor monitors[MaxMonitorsPerHeater];	// embedding them in the Heater uses less memory than dynamic allocation
@@ -115,6 +126,11 @@ private:
 	float requestedTemperature;						// The required temperature
 	float maxTempExcursion;							// The maximum temperature excursion permitted while maintaining the setpoint
 	float maxHeatingFaultTime;						// How long a heater fault is permitted to persist before a heater fault is raised
+	float coupledPwm;								// The equivalent PWM that reaches this heater from other heaters in its coupled group
+	float resistance;								// The heater resistance in ohms, or 0 if it is not included in the power budget
+	float requestedPwm;								// The PWM that the heater asked for last time
+	float pwmLimit;									// The maximum PWM that the power budget allows
+	uint8_t powerPriority;							// Priority when sharing out the power budget, 0 is the highest
 };
 
 #endif /* SRC_HEATING_HEATER_H_ */
@@ -13,6 +13,8 @@
 // Private constants
 const uint32_t InitialTuningReadingInterval = 250;	// the initial reading interval in milliseconds
 const uint32_t TempSettleTimeout = 20000;	// how long we allow the initial temperature to settle
+const float DeadTimeControlSteps = 16.0;			// how many control steps we want in the dead time of the heater
+const unsigned int MaxControlIntervalMultiple = 8;	// the most heat task cycles we allow between control steps
 
 // Variables used during heater tuning
 static float tuningPwm;									// the PWM to use, 0..1
@@ -80,6 +82,7 @@ void LocalHeater::ResetHeater()
 	averagePWM = lastPwm = 0.0;
 	heatingFaultCount = 0;
 	temperature = BadErrorTemperature;
+	SetControlInterval();							// the model may still be enabled
 }
 
 // Configure the heater port and the sensor number
@@ -124,6 +127,7 @@ GCodeResult LocalHeater::ReportDetails(const StringRef& reply) const
 	{
 		reply.cat(", no sensor");
 	}
+	reply.catf(", control interval %" PRIu32 "ms", GetControlIntervalMillis());
 	return GCodeResult::ok;
 }
 
@@ -178,21 +182,60 @@ void LocalHeater::SwitchOff()
 }
 
 // This is called when the heater model has been updated. Returns true if successful.
+// Heaters with a long dead time such as beds don't need controlling as often as hot ends, so we choose the control interval from the dead time.
 GCodeResult LocalHeater::UpdateModel(const StringRef& reply)
 {
+	SetControlInterval();
 	return GCodeResult::ok;
 }
 
-// This is the main heater control loop function
+// Set the control interval from the heater model
+void LocalHeater::SetControlInterval() noexcept
+{
+	if (GetModel().IsEnabled())
+	{
+		const float interval = (GetModel().GetDeadTime() * SecondsToMillis)/(DeadTimeControlSteps * HeatSampleIntervalMillis);
+		controlIntervalMultiple = (uint8_t)constrain<float>(interval, 1.0, (float)MaxControlIntervalMultiple);
+	}
+	else
+	{
+		controlIntervalMultiple = 1;
+	}
+	controlTicksLeft = 1;
+}
+
+// Update the running average PWM. This is called on every heat task cycle whether or not we do a control step.
+void LocalHeater::UpdateAveragePwm() noexcept
+{
+	averagePWM = averagePWM * (1.0 - HeatSampleIntervalMillis/(HeatPwmAverageTime * SecondsToMillis)) + lastPwm;
+}
+
+// This is the main heater control loop function. It is called on every heat task cycle.
+// Temperature reading errors and the safety checks are handled on every call, but the PWM is only recalculated on control steps.
 void LocalHeater::Spin()
 {
 	// Read the temperature even if the heater is suspended or the model is not enabled
 	const TemperatureError err = ReadTemperature();
 
+	// If this heater is controlled less often than once per heat task cycle, see whether this is a control step. Tuning, off and fault states are handled on every call.
+	bool isControlStep = true;
+	if (controlTicksLeft > 1 && mode > HeaterMode::suspended && mode < HeaterMode::firstTuningMode)
+	{
+		--controlTicksLeft;
+		isControlStep = false;
+	}
+	else
+	{
+		controlTicksLeft = controlIntervalMultiple;
+	}
+
 	// Handle any temperature reading error and calculate the temperature rate of change, if possible
 	if (err != TemperatureError::success)
 	{
-		previousTemperaturesGood <<= 1;				// this reading isn't a good one
+		if (isControlStep)
+		{
+			previousTemperaturesGood <<= 1;			// this reading isn't a good one
+		}
 		if (mode > HeaterMode::suspended)			// don't worry about errors when reading heaters that are switched off or flagged as having faults
 		{
 			// Error may be a temporary error and may correct itself after a few additional reads
@@ -211,23 +254,26 @@ void LocalHeater::Spin()
 	}
 	else
 	{
-		// We have an apparently-good temperature reading. Calculate the derivative, if possible.
+		// We have an apparently-good temperature reading. On control steps, calculate the derivative if possible.
 		float derivative = 0.0;
 		bool gotDerivative = false;
 		badTemperatureCount = 0;
-		if ((previousTemperaturesGood & (1 << (NumPreviousTemperatures - 1))) != 0)
+		if (isControlStep)
 		{
-			const float tentativeDerivative = ((float)SecondsToMillis/HeatSampleIntervalMillis) * (temperature - previousTemperatures[previousTemperatureIndex])
-							/ (float)(NumPreviousTemperatures);
-			// Some sensors give occasional temperature spikes. We don't expect the temperature to increase by more than 10C/second.
-			if (fabsf(tentativeDerivative) <= 10.0)
+			if ((previousTemperaturesGood & (1 << (NumPreviousTemperatures - 1))) != 0)
 			{
-				derivative = tentativeDerivative;
-				gotDerivative = true;
+				const float tentativeDerivative = ((float)SecondsToMillis/GetControlIntervalMillis()) * (temperature - previousTemperatures[previousTemperatureIndex])
+								/ (float)(NumPreviousTemperatures);
+				// Some sensors give occasional temperature spikes. We don't expect the temperature to increase by more than 10C/second.
+				if (fabsf(tentativeDerivative) <= 10.0)
+				{
+					derivative = tentativeDerivative;
+					gotDerivative = true;
+				}
 			}
+			previousTemperatures[previousTemperatureIndex] = temperature;
+			previousTemperaturesGood = (previousTemperaturesGood << 1) | 1;
 		}
-		previousTemperatures[previousTemperatureIndex] = temperature;
-		previousTemperaturesGood = (previousTemperaturesGood << 1) | 1;
 
 		if (GetModel().IsEnabled())
 		{
@@ -248,10 +294,11 @@ void LocalHeater::Spin()
 					else if (gotDerivative)
 					{
 						const float expectedRate = GetExpectedHeatingRate();
+						// We only get a derivative on control steps, so count the whole control interval. The count is in heat task cycles.
 						if (derivative + AllowedTemperatureDerivativeNoise < expectedRate
 							&& (float)(millis() - timeSetHeating) > GetModel().GetDeadTime() * SecondsToMillis * 2)
 						{
-							++heatingFaultCount;
+							heatingFaultCount += controlIntervalMultiple;
 							if (heatingFaultCount * HeatSampleIntervalMillis > GetMaxHeatingFaultTime() * SecondsToMillis)
 							{
 								SetHeater(0.0);					// do this here just to be sure
@@ -262,9 +309,9 @@ void LocalHeater::Spin()
 									GetHeaterNumber(), (double)expectedRate);
 							}
 						}
-						else if (heatingFaultCount != 0)
+						else
 						{
-							--heatingFaultCount;
+							heatingFaultCount = (heatingFaultCount > controlIntervalMultiple) ? heatingFaultCount - controlIntervalMultiple : 0;
 						}
 					}
 					else
@@ -319,63 +366,71 @@ void LocalHeater::Spin()
 			}
 			else if (mode < HeaterMode::firstTuningMode)
 			{
-				// Performing normal temperature control
-				if (GetModel().UsePid())
+				// Performing normal temperature control. Between control steps we keep the PWM we calculated last time, but the power budget and the heater monitors are still applied.
+				if (isControlStep)
 				{
-					// Using PID mode. Determine the PID parameters to use.
-					const bool inLoadMode = (mode == HeaterMode::stable) || fabsf(error) < 3.0;		// use standard PID when maintaining temperature
-					const PidParameters& params = GetModel().GetPidParameters(inLoadMode);
-
-					// If the P and D terms together demand that the heater is full on or full off, disregard the I term
-					const float errorMinusDterm = error - (params.tD * derivative);
-					const float pPlusD = params.kP * errorMinusDterm;
-					const float expectedPwm = constrain<float>((temperature - NormalAmbientTemperature)/GetModel().GetGainFanOff(), 0.0, GetModel().GetMaxPwm());
-					if (pPlusD + expectedPwm > GetModel().GetMaxPwm())
+					if (GetModel().UsePid())
 					{
-						lastPwm = GetModel().GetMaxPwm();
-						// If we are heating up, preset the I term to the expected PWM at this temperature, ready for the switch over to PID
-						if (mode == HeaterMode::heating && error > 0.0 && derivative > 0.0)
+						// Using PID mode. Determine the PID parameters to use.
+						const bool inLoadMode = (mode == HeaterMode::stable) || fabsf(error) < 3.0;		// use standard PID when maintaining temperature
+						const PidParameters& params = GetModel().GetPidParameters(inLoadMode);
+
+						// If the P and D terms together demand that the heater is full on or full off, disregard the I term
+						const float errorMinusDterm = error - (params.tD * derivative);
+						const float pPlusD = params.kP * errorMinusDterm;
+						const float expectedPwm = constrain<float>((temperature - NormalAmbientTemperature)/GetModel().GetGainFanOff(), 0.0, GetModel().GetMaxPwm());
+						const float coupledPwm = GetCoupledPwm();			// the heat we are getting from other heaters in our coupled group, expressed as our own PWM
+						if (pPlusD + expectedPwm - coupledPwm > GetModel().GetMaxPwm())
 						{
-							iAccumulator = expectedPwm;
+							lastPwm = GetModel().GetMaxPwm();
+							// If we are heating up, preset the I term to the expected PWM at this temperature, ready for the switch over to PID
+							if (mode == HeaterMode::heating && error > 0.0 && derivative > 0.0)
+							{
+								iAccumulator = expectedPwm;
+							}
+						}
+						else if (pPlusD + expectedPwm - coupledPwm < 0.0)
+						{
+							lastPwm = 0.0;
+						}
+						else
+						{
+							const float errorToUse = error;
+							iAccumulator = constrain<float>
+											(iAccumulator + (errorToUse * params.kP * params.recipTi * GetControlIntervalMillis() * MillisToSeconds),
+												0.0, GetModel().GetMaxPwm());
+							lastPwm = constrain<float>(pPlusD + iAccumulator - coupledPwm, 0.0, GetModel().GetMaxPwm());
 						}
-					}
-					else if (pPlusD + expectedPwm < 0.0)
-					{
-						lastPwm = 0.0;
-					}
-					else
-					{
-						const float errorToUse = error;
-						iAccumulator = constrain<float>
-										(iAccumulator + (errorToUse * params.kP * params.recipTi * HeatSampleIntervalMillis * MillisToSeconds),
-											0.0, GetModel().GetMaxPwm());
-						lastPwm = constrain<float>(pPlusD + iAccumulator, 0.0, GetModel().GetMaxPwm());
-					}
 #if HAS_VOLTAGE_MONITOR
-					// Scale the PID based on the current voltage vs. the calibration voltage
-					if (lastPwm < 1.0 && GetModel().GetVoltage() >= 10.0)				// if heater is not fully on and we know the voltage we tuned the heater at
-					{
-						if (!Heat::IsBedOrChamberHeater(GetHeaterNumber()))
+						// Scale the PID based on the current voltage vs. the calibration voltage
+						if (lastPwm < 1.0 && GetModel().GetVoltage() >= 10.0)				// if heater is not fully on and we know the voltage we tuned the heater at
 						{
-							const float currentVoltage = Platform::GetCurrentVinVoltage();
-							if (currentVoltage >= 10.0)				// if we have a sensible reading
+							if (!Heat::IsBedOrChamberHeater(GetHeaterNumber()))
 							{
-								lastPwm = min<float>(lastPwm * fsquare(GetModel().GetVoltage()/currentVoltage), 1.0);	// adjust the PWM by the square of the voltage ratio
+								const float currentVoltage = Platform::GetCurrentVinVoltage();
+								if (currentVoltage >= 10.0)				// if we have a sensible reading
+								{
+									lastPwm = min<float>(lastPwm * fsquare(GetModel().GetVoltage()/currentVoltage), 1.0);	// adjust the PWM by the square of the voltage ratio
+								}
 							}
 						}
-					}
 #endif
+					}
+					else
+					{
+						// Using bang-bang mode
+						lastPwm = (error > 0.0) ? GetModel().GetMaxPwm() : 0.0;
+					}
+
+					// Check if the generated PWM signal needs to be inverted for inverse temperature control
+					if (GetModel().IsInverted())
+					{
+						lastPwm = GetModel().GetMaxPwm() - lastPwm;
+					}
 				}
 				else
 				{
-					// Using bang-bang mode
-					lastPwm = (error > 0.0) ? GetModel().GetMaxPwm() : 0.0;
-				}
-
-				// Check if the generated PWM signal needs to be inverted for inverse temperature control
-				if (GetModel().IsInverted())
-				{
-					lastPwm = GetModel().GetMaxPwm() - lastPwm;
+					lastPwm = GetRequestedPwm();
 				}
 
 				// Verify that everything is operating in the required temperature range
@@ -415,9 +470,13 @@ void LocalHeater::Spin()
 		}
 
 		// Set the heater power and update the average PWM
+		lastPwm = ApplyPwmLimit(lastPwm);
 		SetHeater(lastPwm);
-		averagePWM = averagePWM * (1.0 - HeatSampleIntervalMillis/(HeatPwmAverageTime * SecondsToMillis)) + lastPwm;
-		previousTemperatureIndex = (previousTemperatureIndex + 1) % NumPreviousTemperatures;
+		UpdateAveragePwm();
+		if (isControlStep)
+		{
+			previousTemperatureIndex = (previousTemperatureIndex + 1) % NumPreviousTemperatures;
+		}
 
 		// For temperature sensors which do not require frequent sampling and averaging,
 		// their temperature is read here and error/safety handling performed.  However,
@@ -55,6 +55,9 @@ private:
 	TemperatureError ReadTemperature();				// Read and store the temperature of this heater
 	void DoTuningStep();							// Called on each temperature sample when auto tuning
 	float GetExpectedHeatingRate() const;			// Get the minimum heating rate we expect
+	uint32_t GetControlIntervalMillis() const noexcept { return controlIntervalMultiple * HeatSampleIntervalMillis; }
+	void SetControlInterval() noexcept;				// Set the number of heat task cycles between control steps from the model
+	void UpdateAveragePwm() noexcept;
 
 	PwmPort port;									// The port that drives the heater
 	float temperature;								// The current temperature
@@ -71,6 +74,8 @@ private:
 	uint8_t previousTemperaturesGood;				// Bitmap indicating which previous temperature were good readings
 	HeaterMode mode;								// Current state of the heater
 	uint8_t badTemperatureCount;					// Count of sequential dud readings
+	uint8_t controlIntervalMultiple;				// How many heat task cycles there are between control steps
+	uint8_t controlTicksLeft;						// How many more heat task cycles until the next control step
 
 	static_assert(sizeof(previousTemperaturesGood) * 8 >= NumPreviousTemperatures, "too few bits in previousTemperaturesGood");
 };
@@ -0,0 +1,45 @@
+/*
+ * FixedPointLog.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ */
+
+#include "FixedPointLog.h"
+
+// Table of log2(1 + i/128) * 65536 for i = 0..128
+static constexpr uint32_t Log2Table[129] =
+{
+	0, 736, 1466, 2190, 2909, 3623, 4331, 5034,
+	5732, 6425, 7112, 7795, 8473, 9146, 9814, 10477,
+	11136, 11791, 12440, 13086, 13727, 14363, 14996, 15624,
+	16248, 16868, 17484, 18096, 18704, 19308, 19909, 20505,
+	21098, 21687, 22272, 22854, 23433, 24007, 24579, 25146,
+	25711, 26272, 26830, 27384, 27936, 28484, 29029, 29571,
+	30109, 30645, 31178, 31707, 32234, 32758, 33279, 33797,
+	34312, 34825, 35334, 35841, 36346, 36847, 37346, 37842,
+	38336, 38827, 39316, 39802, 40286, 40767, 41246, 41722,
+	42196, 42667, 43137, 43603, 44068, 44530, 44990, 45448,
+	45904, 46357, 46809, 47258, 47705, 48150, 48593, 49034,
+	49472, 49909, 50344, 50776, 51207, 51636, 52063, 52488,
+	52911, 53332, 53751, 54169, 54584, 54998, 55410, 55820,
+	56229, 56635, 57040, 57443, 57845, 58245, 58643, 59039,
+	59434, 59827, 60219, 60609, 60997, 61384, 61769, 62152,
+	62534, 62915, 63294, 63671, 64047, 64421, 64794, 65166,
+	65536,
+};
+
+static_assert(FixedLogFractionBits == 16);
+
+// Return log2(x) scaled by 2^FixedLogFractionBits. We normalise x so that its top bit is set, then interpolate in the table using the next 7 bits as the index and the 16 after that as the fraction.
+int32_t FixedLog2(uint32_t x) noexcept
+{
+	const unsigned int leadingZeros = __builtin_clz(x);
+	const uint32_t normalised = x << leadingZeros;
+	const uint32_t index = (normalised >> 24) & 0x7F;
+	const uint32_t fraction = (normalised >> 8) & 0xFFFF;
+	const uint32_t low = Log2Table[index];
+	return (int32_t)(((31 - leadingZeros) << FixedLogFractionBits) + low + (((Log2Table[index + 1] - low) * fraction) >> 16));
+}
+
+// End
@@ -0,0 +1,22 @@
+/*
+ * FixedPointLog.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: agent
+ *
+ *  Logarithm calculation using integer arithmetic only, for processors that have no FPU
+ */
+
+#ifndef SRC_HEATING_SENSORS_FIXEDPOINTLOG_H_
+#define SRC_HEATING_SENSORS_FIXEDPOINTLOG_H_
+
+#include "RepRapFirmware.h"
+
+constexpr unsigned int FixedLogFractionBits = 16;
+constexpr float FixedLogToNaturalLog = 0.69314718/(float)(1u << FixedLogFractionBits);	// multiply a fixed point log2 by this to get the natural log
+
+// Return log2(x) scaled by 2^FixedLogFractionBits. The argument must be nonzero. The absolute error is less than 0.00004.
+int32_t FixedLog2(uint32_t x) noexcept
+pre(x != 0);
+
+#endif /* SRC_HEATING_SENSORS_FIXEDPOINTLOG_H_ */
@@ -32,6 +32,12 @@ GCodeResult LinearAnalogSensor::Configure(const CanMessageGenericParser& parser,
 		return GCodeResult::error;
 	}
 
+	if (seen)
+	{
+		// We changed the port, so find the ADC or SDADC filter if there is one
+		adcFilterChannel = Platform::GetAveragingFilterIndex(port);
+	}
+
 	if (parser.GetFloatParam('B', lowTemp))
 	{
 		seen = true;
@@ -50,7 +56,7 @@ GCodeResult LinearAnalogSensor::Configure(const CanMessageGenericParser& parser,
 		CalcDerivedParameters();
 		if (adcFilterChannel >= 0)
 		{
-			Platform::GetAdcFilter(adcFilterChannel)->Init(0);
+			Platform::InitAdcFilter(adcFilterChannel, 0);
 		}
 	}
 	else
@@ -61,21 +67,27 @@ GCodeResult LinearAnalogSensor::Configure(const CanMessageGenericParser& parser,
 	return GCodeResult::ok;
 }
 
+// Unfiltered readings are not shifted by AdcOversampleBits, so that they match UnfilteredAdcRange in CalcDerivedParameters
 void LinearAnalogSensor::Poll()
 {
-	const volatile ThermistorAveragingFilter *tempFilter = Platform::GetAdcFilter(thermistorInputChannel);
 	int32_t tempReading;
-	if (filtered)
+	if (adcFilterChannel < 0)
+	{
+		// No averaging filter on this pin, so read it directly
+		tempReading = (filtered) ? (int32_t)port.ReadAnalog() << AdcOversampleBits : (int32_t)port.ReadAnalog();
+	}
+	else if (filtered)
 	{
-		if (!tempFilter->IsValid())
+		if (!Platform::IsAdcFilterValid(adcFilterChannel))
 		{
 			SetResult(TemperatureError::notReady);
+			return;
 		}
-		tempReading = tempFilter->GetSum()/(tempFilter->NumAveraged() >> AdcOversampleBits);
+		tempReading = Platform::GetAveragedAdcReading(adcFilterChannel, AdcOversampleBits);
 	}
 	else
 	{
-		tempReading = tempFilter->GetLastReading() << AdcOversampleBits;
+		tempReading = Platform::GetLatestAdcReading(adcFilterChannel);
 	}
 
 	SetResult((tempReading * linearIncreasePerCount) + lowTemp, TemperatureError::success);
@@ -17,6 +17,10 @@
 # include <Hardware/NonVolatileMemory.h>
 #endif
 
+#if SAMC21
+# include "FixedPointLog.h"
+#endif
+
 // The Steinhart-Hart equation for thermistor resistance is:
 // 1/T = A + B ln(R) + C [ln(R)]^3
 //
@@ -39,10 +43,9 @@ int32_t Thermistor::GetRawReading(bool& valid) const noexcept
 {
 	if (adcFilterChannel >= 0)
 	{
-		// Filtered ADC channel
-		const volatile ThermistorAveragingFilter *tempFilter = Platform::GetAdcFilter(adcFilterChannel);
-		valid = tempFilter->IsValid();
-		return tempFilter->GetSum()/(tempFilter->NumAveraged() >> AdcOversampleBits);
+		// Filtered ADC or SDADC channel
+		valid = Platform::IsAdcFilterValid(adcFilterChannel);
+		return Platform::GetAveragedAdcReading(adcFilterChannel, AdcOversampleBits);
 	}
 
 	// Raw ADC channel
@@ -67,7 +70,7 @@ GCodeResult Thermistor::Configure(const CanMessageGenericParser& parser, const S
 		adcFilterChannel = Platform::GetAveragingFilterIndex(port);
 		if (adcFilterChannel >= 0)
 		{
-			Platform::GetAdcFilter(adcFilterChannel)->Init((1u << AnalogIn::AdcBits) - 1);
+			Platform::InitAdcFilter(adcFilterChannel, (1u << AnalogIn::AdcBits) - 1);
 #if HAS_VREF_MONITOR
 			// Default the H and L parameters to the values from nonvolatile memory
 			NonVolatileMemory mem;
@@ -99,8 +102,8 @@ GCodeResult Thermistor::Configure(const CanMessageGenericParser& parser, const S
 		if (lVal == 999)
 		{
 #if HAS_VREF_MONITOR
-			const volatile ThermistorAveragingFilter *vssaFilter = Platform::GetVssaFilter(adcFilterChannel);			// this one may be null on SAMC21 tool boards
-			if (vssaFilter == nullptr)
+			const int vssaFilterIndex = Platform::GetVssaFilterIndex(adcFilterChannel);			// this one may be -1 on SAMC21 tool boards
+			if (vssaFilterIndex < 0)
 			{
 				reply.copy("Thermistor input low-end auto calibration is not supported by this hardware");
 				return GCodeResult::error;
@@ -112,7 +115,7 @@ GCodeResult Thermistor::Configure(const CanMessageGenericParser& parser, const S
 				if (valid)
 				{
 					const int32_t computedCorrection =
-									(val - (int32_t)(vssaFilter->GetSum()/(ThermistorAveragingFilter::NumAveraged() >> AdcOversampleBits)))
+									(val - (int32_t)Platform::GetAveragedAdcReading(vssaFilterIndex, AdcOversampleBits))
 										/(1 << (AnalogIn::AdcBits + AdcOversampleBits - 13));
 					if (computedCorrection >= -127 && computedCorrection <= 127)
 					{
@@ -163,9 +166,9 @@ GCodeResult Thermistor::Configure(const CanMessageGenericParser& parser, const S
 			const int32_t val = GetRawReading(valid);
 			if (valid)
 			{
-				const int32_t vrefReading = Platform::GetAdcFilter(VrefFilterIndex)->GetSum();
+				const int32_t vrefReading = Platform::GetAveragedAdcReading(Platform::GetVrefFilterIndex(adcFilterChannel), AdcOversampleBits);
 				const int32_t computedCorrection =
-								(val - (int32_t)(vrefReading/(ThermistorAveragingFilter::NumAveraged() >> AdcOversampleBits)))
+								(val - vrefReading)
 									/(1 << (AnalogIn::AdcBits + AdcOversampleBits - 13));
 				if (computedCorrection >= -127 && computedCorrection <= 127)
 				{
@@ -231,12 +234,12 @@ void Thermistor::Poll()
 
 #if HAS_VREF_MONITOR
 	// Use the actual VSSA and VREF values read by the ADC
-	const volatile ThermistorAveragingFilter *vrefFilter = Platform::GetVrefFilter(adcFilterChannel);
-	const volatile ThermistorAveragingFilter *vssaFilter = Platform::GetVssaFilter(adcFilterChannel);			// this one may be null on SAMC21 tool boards
-	if (tempFilterValid && vrefFilter->IsValid() && (vssaFilter == nullptr || vssaFilter->IsValid()))
+	const unsigned int vrefFilterIndex = Platform::GetVrefFilterIndex(adcFilterChannel);
+	const int vssaFilterIndex = Platform::GetVssaFilterIndex(adcFilterChannel);			// this one may be -1 on SAMC21 tool boards
+	if (tempFilterValid && Platform::IsAdcFilterValid(vrefFilterIndex) && (vssaFilterIndex < 0 || Platform::IsAdcFilterValid(vssaFilterIndex)))
 	{
-		const int32_t rawAveragedVssaReading = (vssaFilter == nullptr) ? 0 : vssaFilter->GetSum()/(vssaFilter->NumAveraged() >> Thermistor::AdcOversampleBits);
-		const int32_t rawAveragedVrefReading = vrefFilter->GetSum()/(vrefFilter->NumAveraged() >> Thermistor::AdcOversampleBits);
+		const int32_t rawAveragedVssaReading = (vssaFilterIndex < 0) ? 0 : (int32_t)Platform::GetAveragedAdcReading(vssaFilterIndex, Thermistor::AdcOversampleBits);
+		const int32_t rawAveragedVrefReading = Platform::GetAveragedAdcReading(vrefFilterIndex, Thermistor::AdcOversampleBits);
 		const int32_t averagedVssaReading = rawAveragedVssaReading + (adcLowOffset * (1 << (AnalogIn::AdcBits - 12 + Thermistor::AdcOversampleBits - 1)));
 		const int32_t averagedVrefReading = rawAveragedVrefReading + (adcHighOffset * (1 << (AnalogIn::AdcBits - 12 + Thermistor::AdcOversampleBits - 1)));
 
@@ -275,7 +278,9 @@ void Thermistor::Poll()
 			}
 			else
 			{
-				const float resistance = seriesR * (float)(averagedTempReading - averagedVssaReading)/(float)(averagedVrefReading - averagedTempReading);
+				const int32_t resistanceNumerator = averagedTempReading - averagedVssaReading;
+				const int32_t resistanceDenominator = averagedVrefReading - averagedTempReading;
+				const float resistance = seriesR * (float)resistanceNumerator/(float)resistanceDenominator;
 #else
 			const int32_t averagedVrefReading = OversampledAdcRange + adcHighOffset;
 			if (averagedVrefReading <= averagedTempReading)
@@ -284,9 +289,11 @@ void Thermistor::Poll()
 			}
 			else
 			{
-				const float denom = (float)(averagedVrefReading - averagedTempReading) - 0.5;
+				// Double the readings so that we can represent the 0.5 offsets using integers
 				const int32_t averagedVssaReading = adcLowOffset;
-				float resistance = seriesR * ((float)(averagedTempReading - averagedVssaReading) + 0.5)/denom;
+				const int32_t resistanceNumerator = 2 * (averagedTempReading - averagedVssaReading) + 1;
+				const int32_t resistanceDenominator = 2 * (averagedVrefReading - averagedTempReading) - 1;
+				const float resistance = seriesR * (float)resistanceNumerator/(float)resistanceDenominator;
 #endif
 				if (isPT1000)
 				{
@@ -299,7 +306,14 @@ void Thermistor::Poll()
 				else
 				{
 					// Else it's a thermistor
+#if SAMC21
+					// The SAMC21 has no FPU so logf is slow. Use the fixed point log of the reading ratio instead, which is accurate to better than 0.01C.
+					const float logResistance = (resistanceNumerator > 0)
+												? logSeriesR + (float)(FixedLog2(resistanceNumerator) - FixedLog2(resistanceDenominator)) * FixedLogToNaturalLog
+													: logf(resistance);
+#else
 					const float logResistance = logf(resistance);
+#endif
 					const float recipT = shA + shB * logResistance + shC * logResistance * logResistance * logResistance;
 					const float temp = (recipT > 0.0) ? (1.0/recipT) + ABS_ZERO : BadErrorTemperature;
 
@@ -331,6 +345,9 @@ void Thermistor::CalcDerivedParameters()
 	shB = 1.0/beta;
 	const float lnR25 = logf(r25);
 	shA = 1.0/(25.0 - ABS_ZERO) - shB * lnR25 - shC * lnR25 * lnR25 * lnR25;
+#if SAMC21
+	logSeriesR = logf(seriesR);
+#endif
 }
 
 #endif	//SUPPORT_THERMISTORS
@@ -47,6 +47,9 @@ private:
 
 	// The following are derived from the configurable parameters
 	float shA, shB;															// derived parameters
+#if SAMC21
+	float logSeriesR;														// natural log of the series resistor, used by the fixed point log calculation
+#endif
 
 	static constexpr int32_t OversampledAdcRange = 1u << (AnalogIn::AdcBits + AdcOversampleBits);	// The readings we pass in should be in range 0..(AdcRange - 1)
 };
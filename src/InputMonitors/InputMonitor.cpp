@@ -11,6 +11,78 @@
 #include <Hardware/IoPorts.h>
 #include <CAN/CanInterface.h>
 #include <CanMessageBuffer.h>
+#include <Movement/StepTimer.h>
+#include <Hardware/SavedSettings.h>
+
+constexpr uint32_t DefaultFrequencyGateMillis = 250;						// how often we measure the frequency if the monitor doesn't have a min interval
+constexpr uint32_t MaxFrequencyPeriodTicks = 10 * StepTimer::StepClockRate;	// if there are no rising edges for this long then we report a frequency of zero
+constexpr uint32_t MaxDebounceMicroseconds = 1000000;
+
+// The modes set by SetMode and SetReportThreshold as we keep them in EEPROM. The main board creates the monitors after each reset, so we apply the mode when a monitor is created.
+// Monitors in the default mode with the default report threshold have no entry.
+constexpr size_t MaxSavedModes = 4;
+struct SavedInputMonitorModes
+{
+	uint8_t numModes;
+	uint8_t spare[3];
+	struct
+	{
+		uint16_t handle;
+		uint8_t mode;
+		uint8_t spare;
+		uint16_t reportThreshold;
+		uint16_t spare2;
+		uint32_t debounceMicroseconds;
+	} modes[MaxSavedModes];
+};
+
+static_assert(sizeof(SavedInputMonitorModes) <= SavedSettings::MaxDataLength);
+static SavedInputMonitorModes savedModes;
+
+// Return the index of the saved mode for a handle, or the number of saved modes if there isn't one
+static size_t FindSavedMode(uint16_t hndl) noexcept
+{
+	size_t i = 0;
+	while (i < savedModes.numModes && savedModes.modes[i].handle != hndl)
+	{
+		++i;
+	}
+	return i;
+}
+
+// Record the mode of a monitor. Return false if there is no room to save it.
+// Must hold a read lock on the list, so that Create doesn't apply a partly-updated mode. Only the main task calls this.
+static bool SaveMode(uint16_t hndl, InputMonitor::Mode mode, uint32_t debounceMicroseconds, uint16_t reportThreshold) noexcept
+{
+	const size_t i = FindSavedMode(hndl);
+	bool ok = true;
+	if (mode == InputMonitor::Mode::state && reportThreshold == 1)
+	{
+		if (i < savedModes.numModes)
+		{
+			--savedModes.numModes;
+			savedModes.modes[i] = savedModes.modes[savedModes.numModes];
+			memset(&savedModes.modes[savedModes.numModes], 0, sizeof(savedModes.modes[0]));
+		}
+	}
+	else if (i < MaxSavedModes)
+	{
+		if (i == savedModes.numModes)
+		{
+			++savedModes.numModes;
+		}
+		savedModes.modes[i].handle = hndl;
+		savedModes.modes[i].mode = (uint8_t)mode;
+		savedModes.modes[i].reportThreshold = reportThreshold;
+		savedModes.modes[i].debounceMicroseconds = debounceMicroseconds;
+	}
+	else
+	{
+		ok = false;
+	}
+	SavedSettings::Save(SavedSettings::Block::inputMonitorModes, &savedModes, sizeof(savedModes));
+	return ok;
+}
 
 InputMonitor * volatile InputMonitor::monitorsList = nullptr;
 InputMonitor * volatile InputMonitor::freeList = nullptr;
@@ -26,7 +98,8 @@ bool InputMonitor::Activate() noexcept
 			// Digital input
 			const irqflags_t flags = IrqSave();
 			ok = port.AttachInterrupt(CommonDigitalPortInterrupt, InterruptMode::change, CallbackParameter(this));
-			state = port.ReadDigital();
+			state = rawState = port.ReadDigital();
+			debouncePending = false;
 			IrqRestore(flags);
 		}
 		else
@@ -61,22 +134,84 @@ void InputMonitor::Deactivate() noexcept
 // Return the analog value of this input
 uint16_t InputMonitor::GetAnalogValue() const noexcept
 {
-	return (threshold != 0) ? port.ReadAnalog()
-			: port.ReadDigital() ? 0xFFFF
-				: 0;
+	switch (mode)
+	{
+	case Mode::debouncedState:
+		return (state) ? 0xFFFF : 0;
+
+	case Mode::edgeCount:
+		return (uint16_t)edgeCount;								// the master can take the difference between successive readings
+
+	case Mode::frequency:
+		return (uint16_t)min<uint32_t>(frequency, 0xFFFF);
+
+	default:
+		return (threshold != 0) ? port.ReadAnalog()
+				: port.ReadDigital() ? 0xFFFF
+					: 0;
+	}
 }
 
 void InputMonitor::DigitalInterrupt() noexcept
 {
 	const bool newState = port.ReadDigital();
-	if (newState != state)
+	switch (mode)
 	{
-		state = newState;
-		if (active)
+	case Mode::state:
+	default:
+		if (newState != state)
 		{
-			sendDue = true;
-			CanInterface::WakeAsyncSenderFromIsr();
+			state = newState;
+			if (active)
+			{
+				sendDue = true;
+				CanInterface::WakeAsyncSenderFromIsr();
+			}
+		}
+		break;
+
+	case Mode::debouncedState:
+		// Just record the change. The async sender task decides when the new state has been stable for long enough to report it.
+		if (newState != rawState)
+		{
+			rawState = newState;
+			whenLastEdgeTicks = StepTimer::GetTimerTicks();
+			if (active)
+			{
+				debouncePending = true;
+				CanInterface::WakeAsyncSenderFromIsr();
+			}
 		}
+		break;
+
+	case Mode::edgeCount:
+	case Mode::frequency:
+		if (newState != state)
+		{
+			// Ignore changes that follow the previous accepted change too closely, they are contact bounce or noise
+			const uint32_t now = StepTimer::GetTimerTicks();
+			if (now - whenLastEdgeTicks >= debounceTicks)
+			{
+				whenLastEdgeTicks = now;
+				state = newState;
+				if (newState)
+				{
+					++edgeCount;
+					if (edgesSinceMeasured == 0)
+					{
+						whenFirstEdgeTicks = now;
+					}
+					++edgesSinceMeasured;
+					whenLastRisingEdgeTicks = now;
+					if (mode == Mode::edgeCount && active && !sendDue && edgeCount - lastReportedValue >= reportThreshold)
+					{
+						sendDue = true;
+						CanInterface::WakeAsyncSenderFromIsr();
+					}
+				}
+			}
+		}
+		break;
 	}
 }
 
@@ -94,9 +229,181 @@ void InputMonitor::AnalogInterrupt(uint16_t reading) noexcept
 	}
 }
 
+// Clear the counts and measurements. If the monitor is active then the caller must disable interrupts.
+void InputMonitor::ResetMeasurements() noexcept
+{
+	debouncePending = false;
+	haveReferenceEdge = false;
+	whenLastEdgeTicks = StepTimer::GetTimerTicks() - debounceTicks;
+	edgeCount = edgesSinceMeasured = 0;
+	frequency = lastReportedValue = 0;
+	whenLastMeasured = millis();
+}
+
+// Called by the async sender task when the raw state of a monitor in debouncedState mode has changed.
+// If the raw state has been stable for the debounce time then make it the reported state, else arrange to check again when it might be.
+void InputMonitor::UpdateDebouncedState(uint32_t& timeToWait) noexcept
+{
+	bool newState;
+	uint32_t whenChanged;
+	{
+		InterruptCriticalSectionLocker ilock;
+		newState = rawState;
+		whenChanged = whenLastEdgeTicks;
+		debouncePending = false;
+	}
+
+	const uint32_t ticksStable = StepTimer::GetTimerTicks() - whenChanged;
+	if (ticksStable < debounceTicks)
+	{
+		debouncePending = true;
+		const uint32_t timeLeft = StepTimer::TicksToIntegerMicroseconds(debounceTicks - ticksStable)/1000 + 1;
+		if (timeLeft < timeToWait)
+		{
+			timeToWait = timeLeft;
+		}
+	}
+	else if (newState != state)
+	{
+		state = newState;
+		sendDue = true;
+	}
+}
+
+// Called by the async sender task to measure the frequency of a monitor in frequency mode once per gate period.
+// We time whole periods from the last rising edge included in the previous measurement to the last one in this gate period, so that low frequencies are measured as accurately as high ones.
+void InputMonitor::UpdateFrequency(uint32_t now, uint32_t& timeToWait) noexcept
+{
+	const uint32_t gateTime = (minInterval != 0) ? minInterval : DefaultFrequencyGateMillis;
+	const uint32_t age = now - whenLastMeasured;
+	if (age < gateTime)
+	{
+		if (gateTime - age < timeToWait)
+		{
+			timeToWait = gateTime - age;
+		}
+		return;
+	}
+
+	whenLastMeasured = now;
+	if (gateTime < timeToWait)
+	{
+		timeToWait = gateTime;
+	}
+
+	uint32_t edges, firstEdgeTicks, lastEdgeTicks;
+	{
+		InterruptCriticalSectionLocker ilock;
+		edges = edgesSinceMeasured;
+		edgesSinceMeasured = 0;
+		firstEdgeTicks = whenFirstEdgeTicks;
+		lastEdgeTicks = whenLastRisingEdgeTicks;
+	}
+
+	if (edges != 0)
+	{
+		if (!haveReferenceEdge)
+		{
+			// This is the first measurement since we started or the input stopped, so we can only time the periods between the edges we have just seen
+			referenceEdgeTicks = firstEdgeTicks;
+			haveReferenceEdge = true;
+			--edges;
+		}
+		if (edges != 0)
+		{
+			frequency = lrintf((float)edges * (float)(10 * StepTimer::StepClockRate)/(float)(lastEdgeTicks - referenceEdgeTicks));
+		}
+		referenceEdgeTicks = lastEdgeTicks;
+	}
+	else if (haveReferenceEdge)
+	{
+		// There were no rising edges during this gate period, so the current period is at least the time since the last one
+		const uint32_t ticksSinceLastEdge = StepTimer::GetTimerTicks() - referenceEdgeTicks;
+		if (ticksSinceLastEdge >= MaxFrequencyPeriodTicks)
+		{
+			frequency = 0;
+			haveReferenceEdge = false;
+		}
+		else
+		{
+			frequency = min<uint32_t>(frequency, (10 * StepTimer::StepClockRate)/ticksSinceLastEdge);
+		}
+	}
+
+	const uint32_t change = (frequency >= lastReportedValue) ? frequency - lastReportedValue : lastReportedValue - frequency;
+	if (change != 0 && change >= reportThreshold)
+	{
+		lastReportedValue = frequency;
+		sendDue = true;
+	}
+}
+
+// Append the mode of a digital input monitor and its current count or frequency
+void InputMonitor::AppendModeDetails(const StringRef& reply) const noexcept
+{
+	switch (mode)
+	{
+	case Mode::debouncedState:
+		reply.catf(", debounce %" PRIu32 "us", StepTimer::TicksToIntegerMicroseconds(debounceTicks));
+		break;
+
+	case Mode::edgeCount:
+		reply.catf(", counting edges, debounce %" PRIu32 "us, report every %u, count %" PRIu32,
+					StepTimer::TicksToIntegerMicroseconds(debounceTicks), reportThreshold, edgeCount);
+		break;
+
+	case Mode::frequency:
+		reply.catf(", measuring frequency, debounce %" PRIu32 "us, report change %.1fHz, frequency %.1fHz",
+					StepTimer::TicksToIntegerMicroseconds(debounceTicks), (double)((float)reportThreshold * 0.1), (double)((float)frequency * 0.1));
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Give a newly-created monitor the mode that was saved for its handle. Must own the write lock before calling this, and the monitor must not yet be active.
+void InputMonitor::ApplySavedMode() noexcept
+{
+	const size_t i = FindSavedMode(handle);
+	if (i < savedModes.numModes)
+	{
+		reportThreshold = savedModes.modes[i].reportThreshold;
+		if (threshold == 0)
+		{
+			mode = (Mode)savedModes.modes[i].mode;
+			debounceTicks = (savedModes.modes[i].debounceMicroseconds * (StepTimer::StepClockRate/1000))/1000;
+		}
+	}
+}
+
 /*static*/ void InputMonitor::Init() noexcept
 {
-	// Nothing needed here yet
+	// Discard the saved modes if they don't make sense
+	if (!SavedSettings::Load(SavedSettings::Block::inputMonitorModes, &savedModes, sizeof(savedModes)) || savedModes.numModes > MaxSavedModes)
+	{
+		memset(&savedModes, 0, sizeof(savedModes));
+	}
+	for (size_t i = 0; i < savedModes.numModes; ++i)
+	{
+		if (savedModes.modes[i].mode > (uint8_t)Mode::frequency || savedModes.modes[i].debounceMicroseconds > MaxDebounceMicroseconds || savedModes.modes[i].reportThreshold == 0)
+		{
+			savedModes.numModes = 0;
+			break;
+		}
+	}
+}
+
+// Report the modes that we have saved
+/*static*/ void InputMonitor::Diagnostics(const StringRef& reply) noexcept
+{
+	ReadLocker lock(listLock);
+	for (size_t i = 0; i < savedModes.numModes; ++i)
+	{
+		reply.lcatf("Input handle %04x mode %u, debounce %" PRIu32 "us, report threshold %u%s",
+						savedModes.modes[i].handle, savedModes.modes[i].mode, savedModes.modes[i].debounceMicroseconds, savedModes.modes[i].reportThreshold,
+							(SavedSettings::IsAvailable()) ? "" : " (not saved, no EEPROM)");
+	}
 }
 
 /*static*/ void InputMonitor::CommonDigitalPortInterrupt(CallbackParameter cbp) noexcept
@@ -172,6 +479,11 @@ void InputMonitor::AnalogInterrupt(uint16_t reading) noexcept
 	newMonitor->minInterval = msg.minInterval;
 	newMonitor->threshold = msg.threshold;
 	newMonitor->sendDue = false;
+	newMonitor->mode = Mode::state;
+	newMonitor->debounceTicks = 0;
+	newMonitor->reportThreshold = 1;
+	newMonitor->ApplySavedMode();
+	newMonitor->ResetMeasurements();
 	String<StringLength50> pinName;
 	pinName.copy(msg.pinName, msg.GetMaxPinNameLength(dataLength));
 	if (newMonitor->port.AssignPort(pinName.c_str(), reply, PinUsedBy::endstop, (msg.threshold == 0) ? PinAccess::read : PinAccess::readAnalog))
@@ -230,6 +542,7 @@ void InputMonitor::AnalogInterrupt(uint16_t reading) noexcept
 	case CanMessageChangeInputMonitor::actionReturnPinName:
 		m->port.AppendPinName(reply);
 		reply.catf(", min interval %ums", m->minInterval);
+		m->AppendModeDetails(reply);
 		rslt = GCodeResult::ok;
 		break;
 
@@ -253,6 +566,64 @@ void InputMonitor::AnalogInterrupt(uint16_t reading) noexcept
 	return rslt;
 }
 
+// Set the mode of a digital input monitor. This and SetReportThreshold are board-local extensions, we reach them through diagnostic tests.
+/*static*/ GCodeResult InputMonitor::SetMode(uint16_t hndl, uint32_t newMode, uint32_t debounceMicroseconds, const StringRef& reply) noexcept
+{
+	auto m = Find(hndl);
+	if (m.IsNull())
+	{
+		reply.printf("Board %u does not have input handle %04x", CanInterface::GetCanAddress(), hndl);
+		return GCodeResult::error;
+	}
+
+	if (newMode > (uint32_t)Mode::frequency)
+	{
+		reply.printf("Input monitor mode %" PRIu32 " not supported", newMode);
+		return GCodeResult::error;
+	}
+
+	if (newMode != (uint32_t)Mode::state && m->threshold != 0)
+	{
+		reply.copy("Only digital input monitors support debouncing, edge counting and frequency measurement");
+		return GCodeResult::error;
+	}
+
+	{
+		InterruptCriticalSectionLocker ilock;
+		m->mode = (Mode)newMode;
+		m->debounceTicks = (min<uint32_t>(debounceMicroseconds, MaxDebounceMicroseconds) * (StepTimer::StepClockRate/1000))/1000;
+		m->ResetMeasurements();
+		m->sendDue = false;
+		m->state = m->rawState = m->port.ReadDigital();
+	}
+	CanInterface::WakeAsyncSender();							// so that it starts measuring the frequency if necessary
+	if (!SaveMode(hndl, m->mode, min<uint32_t>(debounceMicroseconds, MaxDebounceMicroseconds), m->reportThreshold))
+	{
+		reply.copy("Input monitor mode set but not saved, too many monitors");
+		return GCodeResult::warning;
+	}
+	return GCodeResult::ok;
+}
+
+// Set how much the count or frequency must change by before we report it
+/*static*/ GCodeResult InputMonitor::SetReportThreshold(uint16_t hndl, uint32_t newThreshold, const StringRef& reply) noexcept
+{
+	auto m = Find(hndl);
+	if (m.IsNull())
+	{
+		reply.printf("Board %u does not have input handle %04x", CanInterface::GetCanAddress(), hndl);
+		return GCodeResult::error;
+	}
+
+	m->reportThreshold = constrain<uint32_t>(newThreshold, 1, 0xFFFF);
+	if (!SaveMode(hndl, m->mode, StepTimer::TicksToIntegerMicroseconds(m->debounceTicks), m->reportThreshold))
+	{
+		reply.copy("Report threshold set but not saved, too many monitors");
+		return GCodeResult::warning;
+	}
+	return GCodeResult::ok;
+}
+
 // Check the input monitors and add any pending ones to the message
 // Return the number of ticks before we should be woken again, or TaskBase::TimeoutUnlimited if we shouldn't be work until an input changes state
 /*static*/ uint32_t InputMonitor::AddStateChanges(CanMessageInputChanged *msg) noexcept
@@ -263,6 +634,21 @@ void InputMonitor::AnalogInterrupt(uint16_t reading) noexcept
 	const uint32_t now = millis();
 	for (InputMonitor *p = monitorsList; p != nullptr; p = p->next)
 	{
+		if (p->active)
+		{
+			if (p->mode == Mode::debouncedState)
+			{
+				if (p->debouncePending)
+				{
+					p->UpdateDebouncedState(timeToWait);
+				}
+			}
+			else if (p->mode == Mode::frequency)
+			{
+				p->UpdateFrequency(now, timeToWait);
+			}
+		}
+
 		if (p->sendDue)
 		{
 			const uint32_t age = now - p->whenLastSent;
@@ -273,6 +659,10 @@ void InputMonitor::AnalogInterrupt(uint16_t reading) noexcept
 					InterruptCriticalSectionLocker ilock;
 					p->sendDue = false;
 					monitorState = p->state;
+					if (p->mode == Mode::edgeCount)
+					{
+						p->lastReportedValue = p->edgeCount;
+					}
 				}
 
 				if (msg->AddEntry(p->handle, monitorState))
@@ -34,12 +34,30 @@ public:
 	static void CommonDigitalPortInterrupt(CallbackParameter cbp) noexcept;
 	static void CommonAnalogPortInterrupt(CallbackParameter cbp, uint16_t reading) noexcept;
 
+	// How a digital input monitor processes its input. Analog input monitors always use the 'state' mode.
+	enum class Mode : uint8_t
+	{
+		state = 0,						// report every change of state
+		debouncedState,					// report changes of state that persist for the debounce time
+		edgeCount,						// count rising edges, report when the count has increased by the report threshold, value is the count
+		frequency,						// measure the frequency of rising edges once per min interval, report when it has changed by the report threshold, value is in units of 0.1Hz
+	};
+
+	static GCodeResult SetMode(uint16_t hndl, uint32_t newMode, uint32_t debounceMicroseconds, const StringRef& reply) noexcept;
+	static GCodeResult SetReportThreshold(uint16_t hndl, uint32_t newThreshold, const StringRef& reply) noexcept;
+	static void Diagnostics(const StringRef& reply) noexcept;
+
 private:
 	bool Activate() noexcept;
 	void Deactivate() noexcept;
 	void DigitalInterrupt() noexcept;
 	void AnalogInterrupt(uint16_t reading) noexcept;
 	uint16_t GetAnalogValue() const noexcept;
+	void ResetMeasurements() noexcept;
+	void UpdateDebouncedState(uint32_t& timeToWait) noexcept;
+	void UpdateFrequency(uint32_t now, uint32_t& timeToWait) noexcept;
+	void AppendModeDetails(const StringRef& reply) const noexcept;
+	void ApplySavedMode() noexcept;
 
 	static bool Delete(uint16_t hndl) noexcept;
 	static ReadLockedPointer<InputMonitor> Find(uint16_t hndl) noexcept;
@@ -54,6 +72,23 @@ private:
 	volatile bool state;
 	volatile bool sendDue;
 
+	// Debouncing, edge counting and frequency measurement. Times ending in 'Ticks' are in step clocks.
+	Mode mode;
+	volatile bool rawState;								// the last state read by the ISR in debouncedState mode
+	volatile bool debouncePending;						// the raw state has changed and has not yet been found stable
+	bool haveReferenceEdge;								// true if referenceEdgeTicks is valid
+	uint16_t reportThreshold;							// how much the count or frequency must change by before we report it
+	uint32_t debounceTicks;								// in debouncedState mode the time the input must be stable, else the minimum time between accepted edges
+	volatile uint32_t whenLastEdgeTicks;				// when the ISR last accepted a change of state
+	volatile uint32_t whenLastRisingEdgeTicks;			// when the ISR last accepted a rising edge
+	volatile uint32_t whenFirstEdgeTicks;				// when the ISR accepted the first rising edge since the frequency was last measured
+	volatile uint32_t edgeCount;						// number of rising edges accepted
+	volatile uint32_t edgesSinceMeasured;				// number of rising edges accepted since the frequency was last measured
+	uint32_t referenceEdgeTicks;						// the last rising edge included in the previous frequency measurement
+	uint32_t whenLastMeasured;							// millis() when we last measured the frequency
+	uint32_t frequency;									// the last measured frequency in units of 0.1Hz
+	uint32_t lastReportedValue;							// the count or frequency when we last reported it
+
 	static InputMonitor * volatile monitorsList;
 	static InputMonitor * volatile freeList;
 
@@ -269,7 +269,7 @@ bool DDA::Init(const CanMessageMovementLinear& msg)
 		DriveMovement& dm = ddms[drive];
 		if (dm.state == DMState::moving)
 		{
-			Platform::EnableDrive(drive);
+			Platform::EnableDriveForMove(drive, afterPrepare.moveStartTime, GetMoveFinishTime());
 			if ((msg.pressureAdvanceDrives & (1u << drive)) != 0)
 			{
 				// If there is any extruder jerk in this move, in theory that means we need to instantly extrude or retract some amount of filament.
@@ -396,6 +396,31 @@ void DDA::Start(uint32_t tim)
 #endif
 }
 
+#if SUPPORT_SLOW_DRIVERS
+
+// Set the direction pins for this move ahead of its start, for those slow drivers that the previous move (which may still be executing) has finished stepping.
+// Then DDA::Start won't change them again, so the first steps of this move don't have to wait for the direction setup time.
+// Must be called with base priority at least as high as the step interrupt.
+void DDA::PresetDirections(const DDA& prev) const noexcept
+{
+# if SINGLE_DRIVER
+	if (Platform::IsSlowDriver() && ddms[0].state == DMState::moving && prev.ddms[0].state != DMState::moving)
+	{
+		Platform::SetDirection(ddms[0].direction);
+	}
+# else
+	for (size_t drive = 0; drive < NumDrivers; ++drive)
+	{
+		if (Platform::IsSlowDriver(drive) && ddms[drive].state == DMState::moving && prev.ddms[drive].state != DMState::moving)
+		{
+			Platform::SetDirection(drive, ddms[drive].direction);
+		}
+	}
+# endif
+}
+
+#endif
+
 #if USE_TC_FOR_STEP
 uint32_t DDA::lastStepHighTime = 0;
 #else
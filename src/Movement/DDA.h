@@ -45,6 +45,9 @@ public:
 	bool Init(const CanMessageMovementLinear& msg) noexcept SPEED_CRITICAL;		// Set up a move from a CAN message
 	void Start(uint32_t tim) noexcept SPEED_CRITICAL;							// Start executing the DDA, i.e. move the move.
 	void StepDrivers(uint32_t now) noexcept SPEED_CRITICAL;						// Take one step of the DDA, called by timed interrupt.
+#if SUPPORT_SLOW_DRIVERS
+	void PresetDirections(const DDA& prev) const noexcept;						// Set the direction pins of slow drivers that the previous move has finished with
+#endif
 	bool ScheduleNextStepInterrupt(StepTimer& timer) const noexcept SPEED_CRITICAL;		// Schedule the next interrupt, returning true if we can't because it is already due
 
 	void SetNext(DDA *n) noexcept { next = n; }
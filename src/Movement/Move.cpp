@@ -50,6 +50,10 @@ unsigned int getCanMoveTimeoutErrs;
 #endif
 
 constexpr size_t MoveTaskStackWords = 200;
+
+#if SUPPORT_SLOW_DRIVERS
+constexpr uint32_t DirectionPresetMargin = (150 * StepTimer::StepClockRate)/1000000;		// must exceed DDA::WakeupTime because the next move may start that early
+#endif
 static Task<MoveTaskStackWords> *moveTask;
 
 extern "C" [[noreturn]] void MoveLoop(void * param) noexcept
@@ -58,7 +62,7 @@ extern "C" [[noreturn]] void MoveLoop(void * param) noexcept
 }
 
 Move::Move()
-	: currentDda(nullptr), extrudersPrinting(false), taskWaitingForMoveToComplete(nullptr), scheduledMoves(0), completedMoves(0), numHiccups(0)
+	: currentDda(nullptr), extrudersPrinting(false), taskWaitingForMoveToComplete(nullptr), scheduledMoves(0), completedMoves(0), numHiccups(0), totalHiccups(0)
 {
 	kinematics = Kinematics::Create(KinematicsType::cartesian);			// default to Cartesian
 
@@ -75,6 +79,9 @@ Move::Move()
 	dda->SetPrevious(ddaRingAddPointer);
 
 	timer.SetCallback(Move::TimerCallback, static_cast<void*>(this));
+#if SUPPORT_SLOW_DRIVERS
+	directionTimer.SetCallback(Move::DirectionTimerCallback, static_cast<void*>(this));
+#endif
 
 	for (size_t i = 0; i < NumDrivers; ++i)
 	{
@@ -136,8 +143,44 @@ inline void Move::StartNextMove(DDA *cdda, uint32_t startTime)
 	}
 	currentDda = cdda;
 	cdda->Start(startTime);
+
+#if SUPPORT_SLOW_DRIVERS
+	// Schedule setting the direction pins for the following move shortly before this one is due to finish.
+	// The lead time is the configured direction setup time plus an allowance for the next move starting a little early.
+	// Only do this if there are slow drivers that need a direction setup time, because otherwise it just adds an interrupt to every move.
+	const uint32_t dirSetupClocks = Platform::GetSlowDriverDirSetupClocks();
+# if SINGLE_DRIVER
+	if (dirSetupClocks != 0 && Platform::IsSlowDriver())
+# else
+	if (dirSetupClocks != 0 && !Platform::GetSlowDriversBitmap().IsEmpty())
+# endif
+	{
+		if (directionTimer.ScheduleCallbackFromIsr(cdda->GetMoveFinishTime() - (dirSetupClocks + DirectionPresetMargin)))
+		{
+			PresetDirections();
+		}
+	}
+#endif
 }
 
+#if SUPPORT_SLOW_DRIVERS
+
+// This is called from the direction timer interrupt, or when starting a move if the interrupt would be due immediately
+void Move::PresetDirections()
+{
+	const DDA * const cdda = currentDda;							// capture volatile variable
+	if (cdda != nullptr)
+	{
+		const DDA * const ndda = cdda->GetNext();
+		if (ndda->GetState() == DDA::frozen)
+		{
+			ndda->PresetDirections(*cdda);
+		}
+	}
+}
+
+#endif
+
 [[noreturn]] void Move::TaskLoop() noexcept
 {
 	while (true)
@@ -399,6 +442,7 @@ void Move::Interrupt()
 			// Force a break by updating the move start time.
 			// If the inserted hiccup is too short then it won't help. So we double the hiccup time on each iteration.
 			++numHiccups;
+			++totalHiccups;
 			cdda->InsertHiccup(now);
 
 			// Reschedule the next step interrupt. This time it should succeed if the hiccup time was long enough.
@@ -48,11 +48,20 @@ public:
 		static_cast<Move*>(cb.vp)->Interrupt();
 	}
 
+#if SUPPORT_SLOW_DRIVERS
+	static void DirectionTimerCallback(CallbackParameter cb)
+	{
+		static_cast<Move*>(cb.vp)->PresetDirections();
+	}
+#endif
+
 	void PrintCurrentDda() const;													// For debugging
 
 	void ResetMoveCounters() { scheduledMoves = completedMoves = 0; }
+	uint32_t GetTotalHiccups() const noexcept { return totalHiccups; }
 
 	int32_t GetPosition(size_t driver) const;
+	bool IsMoving() const noexcept { return currentDda != nullptr; }
 
 	// Filament monitor support
 	int32_t GetAccumulatedExtrusion(size_t driver, bool& isPrinting) noexcept;		// Return and reset the accumulated commanded extrusion amount
@@ -71,6 +80,9 @@ private:
 	bool DDARingAdd();																// Add a processed look-ahead entry to the DDA ring
 	DDA* DDARingGet();																// Get the next DDA ring entry to be run
 	void StartNextMove(DDA *cdda, uint32_t startTime);								// Start a move
+#if SUPPORT_SLOW_DRIVERS
+	void PresetDirections() SPEED_CRITICAL;											// Set the direction pins for the move after the current one
+#endif
 
 	// Variables that are in the DDARing class in RepRapFirmware (we have only one DDARing so they are here)
 	DDA* volatile currentDda;
@@ -79,6 +91,9 @@ private:
 	DDA* ddaRingCheckPointer;
 
 	StepTimer timer;
+#if SUPPORT_SLOW_DRIVERS
+	StepTimer directionTimer;														// Timer used to set the direction pins for the next move before it starts
+#endif
 	volatile int32_t extrusionAccumulators[NumDrivers]; 							// Accumulated extruder motor steps
 	volatile uint32_t extrudersPrintingSince;										// The milliseconds clock time when extrudersPrinting was set to true
 	volatile bool extrudersPrinting;												// Set whenever an extruder starts a printing move, cleared by a non-printing extruder move
@@ -90,6 +105,7 @@ private:
 	uint32_t scheduledMoves;														// Move counters for the code queue
 	volatile uint32_t completedMoves;												// This one is modified by an ISR, hence volatile
 	uint32_t numHiccups;															// How many times we delayed an interrupt to avoid using too much CPU time in interrupts
+	uint32_t totalHiccups;															// As numHiccups but never cleared, used for event logging
 	uint32_t maxPrepareTime;
 };
 
@@ -40,7 +40,8 @@ enum class SmartDriverRegister : unsigned int
 	thigh,
 	mstepPos,
 	pwmScale,
-	pwmAuto
+	pwmAuto,
+	coolConf
 };
 
 #endif /* SRC_MOVEMENT_STEPPERDRIVERS_DRIVERMODE_H_ */
@@ -101,6 +101,12 @@ enum class DriversState : uint8_t
 
 static DriversState driversState = DriversState::shutDown;
 
+// Drivers whose fault status has changed since the main task last asked, so that it can deal with them straight away instead of waiting its turn to poll them.
+// These are written by the ISR, so the main task must disable interrupts to read and clear them.
+constexpr uint32_t FaultStatusBits = TMC_RR_OT | TMC_RR_OTPW | TMC_RR_S2G;
+static DriversBitmap driversWithChangedFaults;
+static uint32_t whenFaultsChanged;							// the step clock when we saw the first of those changes
+
 #if TMC22xx_USE_SLAVEADDR
 static bool currentMuxState;
 #endif
@@ -570,6 +576,7 @@ private:
 	volatile uint32_t accumulatedReadRegisters[NumReadRegisters];
 
 	uint32_t configuredChopConfReg;							// the configured chopper control register, in the Enabled state, without the microstepping bits
+	uint32_t lastFaultBits;									// the fault bits in the last DRV_STATUS that we checked
 	volatile uint32_t registersToUpdate;					// bitmap of register indices whose values need to be sent to the driver chip
 
 	uint32_t axisNumber;									// the axis number of this driver as used to index the DriveMovements in the DDA
@@ -993,6 +1000,7 @@ pre(!driversPowered)
 #if RESET_MICROSTEP_COUNTERS_AT_INIT
 	hadStepFailure = false;
 #endif
+	lastFaultBits = 0;
 	registersToUpdate = 0;
 	motorCurrent = 0.0;
 	standstillCurrentFraction = (uint8_t)min<uint32_t>((DefaultStandstillCurrentPercent * 256)/100, 255);
@@ -1120,6 +1128,7 @@ bool TmcDriverState::SetRegister(SmartDriverRegister reg, uint32_t regVal) noexc
 
 #if HAS_STALL_DETECT
 	case SmartDriverRegister::coolStep:
+	case SmartDriverRegister::coolConf:
 		UpdateRegister(WriteCoolconf, regVal & ((1u << 16) - 1));
 		return true;
 #endif
@@ -1163,6 +1172,7 @@ uint32_t TmcDriverState::GetRegister(SmartDriverRegister reg) const noexcept
 
 	case SmartDriverRegister::hdec:
 	case SmartDriverRegister::coolStep:
+	case SmartDriverRegister::coolConf:
 	default:
 		return 0;
 	}
@@ -1395,6 +1405,18 @@ inline void TmcDriverState::TransferDone() noexcept
 				{
 					regVal &= ~(TMC_RR_OLA | TMC_RR_OLB);				// open load bits are unreliable at standstill and low speeds
 				}
+
+				// If the fault status has changed, flag this driver to the main task
+				const uint32_t faultBits = regVal & FaultStatusBits;
+				if (faultBits != lastFaultBits)
+				{
+					lastFaultBits = faultBits;
+					if (driversWithChangedFaults.IsEmpty())
+					{
+						whenFaultsChanged = StepTimer::GetTimerTicks();
+					}
+					driversWithChangedFaults.SetBit(driverNumber);
+				}
 			}
 #if HAS_STALL_DETECT
 			else if (registerToRead == ReadSgResult)
@@ -1998,6 +2020,16 @@ uint32_t SmartDrivers::GetAccumulatedStatus(size_t drive, uint32_t bitsToKeep) n
 	return (drive < GetNumTmcDrivers()) ? driverStates[drive].ReadAccumulatedStatus(bitsToKeep) : 0;
 }
 
+// Return the drivers whose fault status has changed since the last call, and the step clock when the first of those changes was seen
+DriversBitmap SmartDrivers::GetDriversWithChangedFaults(uint32_t& whenChanged) noexcept
+{
+	AtomicCriticalSectionLocker lock;
+	const DriversBitmap ret = driversWithChangedFaults;
+	driversWithChangedFaults.Clear();
+	whenChanged = whenFaultsChanged;
+	return ret;
+}
+
 // Set microstepping or chopper control register
 bool SmartDrivers::SetMicrostepping(size_t drive, unsigned int microsteps, bool interpolate) noexcept
 {
@@ -47,6 +47,7 @@ namespace SmartDrivers
 	void EnableDrive(size_t drive, bool en) noexcept;
 	uint32_t GetLiveStatus(size_t drive) noexcept;
 	uint32_t GetAccumulatedStatus(size_t drive, uint32_t bitsToKeep) noexcept;
+	DriversBitmap GetDriversWithChangedFaults(uint32_t& whenChanged) noexcept;
 	bool SetMicrostepping(size_t drive, unsigned int microsteps, bool interpolation) noexcept;
 	unsigned int GetMicrostepping(size_t drive, bool& interpolation) noexcept;
 	bool SetDriverMode(size_t driver, unsigned int mode) noexcept;
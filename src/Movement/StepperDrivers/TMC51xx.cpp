@@ -201,9 +201,18 @@ const uint32_t DefaultThighReg = DefaultThigh;
 
 constexpr uint8_t REGNUM_VACTUAL = 0x22;
 
+// Microstep table registers (write only). The table holds a quarter sine wave as 256 differences between successive entries.
+// Entry x+1 is entry x plus (bit x of the MSLUT registers + W - 1), where W is the width for the segment containing x given by MSLUTSEL.
+constexpr uint8_t REGNUM_MSLUT0 = 0x60;						// 8 registers, MSLUT0 to MSLUT7
+constexpr uint8_t REGNUM_MSLUTSEL = 0x68;					// bits 0-7 are W0-W3 (2 bits each), bits 8-15/16-23/24-31 are X1-X3 where segments 1-3 start
+constexpr uint8_t REGNUM_MSLUTSTART = 0x69;					// bits 0-7 are START_SIN, bits 16-23 are START_SIN90
+
 // Sequencer registers (read only)
 constexpr uint8_t REGNUM_MSCNT = 0x6A;
 constexpr uint8_t REGNUM_MSCURACT = 0x6B;
+constexpr uint32_t MSCURACT_CUR_A_MASK = 0x1FF;				// actual current in coil A, 9-bit signed
+constexpr uint32_t MSCURACT_CUR_B_SHIFT = 16;				// actual current in coil B, 9-bit signed
+constexpr uint32_t TSTEP_MASK = 0xFFFFF;
 
 // Chopper control registers
 
@@ -237,6 +246,8 @@ constexpr uint8_t REGNUM_COOLCONF = 0x6D;
 constexpr uint32_t COOLCONF_SGFILT = 1 << 24;				// set to update stallGuard status every 4 full steps instead of every full step
 constexpr uint32_t COOLCONF_SGT_SHIFT = 16;
 constexpr uint32_t COOLCONF_SGT_MASK = 127 << COOLCONF_SGT_SHIFT;	// stallguard threshold (signed)
+constexpr uint32_t COOLCONF_SEMIN_MASK = 0x0F;				// coolStep lower stallGuard threshold, 0 disables coolStep
+constexpr uint32_t COOLCONF_COOLSTEP_MASK = 0xFFFF;			// the SEMIN, SEUP, SEMAX, SEDN and SEIMIN fields
 
 // DRV_STATUS register. See the .h file for the bit definitions.
 constexpr uint8_t REGNUM_DRV_STATUS = 0x6F;
@@ -262,6 +273,39 @@ enum class DriversState : uint8_t
 
 static DriversState driversState = DriversState::noPower;
 
+// Coil current capture. While a capture is in progress, each selected driver reads MSCURACT (and optionally TSTEP) instead of MSCNT and PWM_SCALE
+// in its normal read cycle whenever it has no register writes pending. The sample buffer is allocated the first time we capture and kept.
+struct CoilCurrentSample
+{
+	uint32_t whenRequested;			// the step clock when the transfer that latched the value completed
+	uint32_t tStep;					// the most recent TSTEP value, if TSTEP is being captured
+	int16_t currentA, currentB;		// the coil currents from MSCURACT
+	uint8_t driver;
+};
+
+#if SAME5x
+constexpr unsigned int MaxCoilCurrentSamples = 1000;
+#else
+constexpr unsigned int MaxCoilCurrentSamples = 200;
+#endif
+constexpr unsigned int MaxCoilCurrentSamplesPerReply = 12;
+
+static CoilCurrentSample *coilCurrentSamples = nullptr;		// allocated when we are first asked to do a capture
+static volatile unsigned int numCoilCurrentSamplesWanted = 0;
+static volatile unsigned int numCoilCurrentSamplesTaken = 0;
+static DriversBitmap coilCurrentCaptureDrivers;
+static bool coilCurrentCaptureTStep = false;
+
+// Drivers whose fault status has changed since the main task last asked, so that it can deal with them straight away instead of waiting its turn to poll them
+constexpr uint32_t FaultStatusBits = TMC_RR_OT | TMC_RR_OTPW | TMC_RR_S2G;
+static DriversBitmap driversWithChangedFaults;
+static uint32_t whenFaultsChanged;							// the step clock when we saw the first of those changes
+
+static inline int16_t SignExtend9(uint32_t val)
+{
+	return (int16_t)(val << 7) >> 7;
+}
+
 //----------------------------------------------------------------------------------------------------------------------------------
 // Private types and methods
 
@@ -290,6 +334,7 @@ public:
 
 	float GetStandstillCurrentPercent() const;
 	void SetStandstillCurrentPercent(float percent);
+	void SetMicrostepTable(const uint32_t *msLut, uint32_t msLutSel, uint32_t msLutStart);
 
 	static void TransferTimedOut() { ++numTimeouts; }
 
@@ -310,8 +355,12 @@ private:
 	{
 		minSgLoadRegister = 1023;
 		maxSgLoadRegister = 0;
+		minCsActual = 31;
+		maxCsActual = 0;
 	}
 
+	uint32_t CsActualToCurrent(uint32_t csActual) const;
+
 	// Write register numbers are in priority order, most urgent first, in same order as WriteRegNumbers
 	static constexpr unsigned int WriteGConf = 0;			// microstepping
 	static constexpr unsigned int WriteIholdIrun = 1;		// current setting
@@ -325,11 +374,14 @@ private:
 	static constexpr unsigned int Write5160ShortConf = 8;	// short circuit detection configuration
 	static constexpr unsigned int Write5160DrvConf = 9;		// driver timing
 	static constexpr unsigned int Write5160GlobalScaler = 10; // motor current scaling
-
-	static constexpr unsigned int NumWriteRegisters = 11;	// the number of registers that we write to
+	static constexpr unsigned int WriteMsLut0 = 11;			// first of 8 microstep table registers
 #else
-	static constexpr unsigned int NumWriteRegisters = 8;	// the number of registers that we write to
+	static constexpr unsigned int WriteMsLut0 = 8;			// first of 8 microstep table registers
 #endif
+	static constexpr unsigned int WriteMsLutSel = WriteMsLut0 + SmartDrivers::NumMsLutRegisters;	// microstep table segment widths
+	static constexpr unsigned int WriteMsLutStart = WriteMsLutSel + 1;								// microstep table start values
+
+	static constexpr unsigned int NumWriteRegisters = WriteMsLutStart + 1;	// the number of registers that we write to
 
 	static const uint8_t WriteRegNumbers[NumWriteRegisters];	// the register numbers that we write to
 
@@ -344,6 +396,10 @@ private:
 
 	static constexpr uint8_t NoRegIndex = 0xFF;				// this means no register updated, or no register requested
 
+	// Pseudo read register indices used when capturing coil currents. These are not part of the normal read cycle.
+	static constexpr uint8_t CaptureMsCurAct = NumReadRegisters;
+	static constexpr uint8_t CaptureTStep = NumReadRegisters + 1;
+
 	volatile uint32_t writeRegisters[NumWriteRegisters];	// the values we want the TMC22xx writable registers to have
 	volatile uint32_t readRegisters[NumReadRegisters];		// the last values read from the TMC22xx readable registers
 	volatile uint32_t accumulatedReadRegisters[NumReadRegisters];
@@ -351,6 +407,9 @@ private:
 	uint32_t configuredChopConfReg;							// the configured chopper control register, in the Enabled state, without the microstepping bits
 	uint32_t minSgLoadRegister;								// the minimum value of the StallGuard bits we read
 	uint32_t maxSgLoadRegister;								// the maximum value of the StallGuard bits we read
+	uint32_t lastFaultBits;									// the fault bits in the last DRV_STATUS that we checked
+	uint32_t minCsActual;									// the minimum current scale applied by coolStep while moving
+	uint32_t maxCsActual;									// the maximum current scale applied by coolStep while moving
 
 	volatile uint32_t newRegistersToUpdate;					// bitmap of register indices whose values need to be sent to the driver chip
 	uint32_t registersToUpdate;								// bitmap of register indices whose values need to be sent to the driver chip
@@ -366,7 +425,11 @@ private:
 	uint8_t regIndexBeingUpdated;							// which register we are sending
 	uint8_t regIndexRequested;								// the register we asked to read in the previous transaction, or 0xFF
 	uint8_t previousRegIndexRequested;						// the register we asked to read in the previous transaction, or 0xFF
+	uint8_t captureRegIndex;								// the capture register we are reading in this transaction, or 0xFF
 	bool enabled;											// true if driver is enabled
+	bool captureTStepNext;									// true if the next capture read should be of TSTEP
+	uint32_t captureRequestTime;							// the step clock when the last capture read request completed
+	uint32_t lastTStep;										// the last TSTEP value captured
 };
 
 const uint8_t TmcDriverState::WriteRegNumbers[NumWriteRegisters] =
@@ -382,8 +445,11 @@ const uint8_t TmcDriverState::WriteRegNumbers[NumWriteRegisters] =
 #if TMC_TYPE == 5160
 	REGNUM_5160_SHORTCONF,
 	REGNUM_5160_DRVCONF,
-	REGNUM_5160_GLOBAL_SCALER
+	REGNUM_5160_GLOBAL_SCALER,
 #endif
+	REGNUM_MSLUT0, REGNUM_MSLUT0 + 1, REGNUM_MSLUT0 + 2, REGNUM_MSLUT0 + 3, REGNUM_MSLUT0 + 4, REGNUM_MSLUT0 + 5, REGNUM_MSLUT0 + 6, REGNUM_MSLUT0 + 7,
+	REGNUM_MSLUTSEL,
+	REGNUM_MSLUTSTART
 };
 
 const uint8_t TmcDriverState::ReadRegNumbers[NumReadRegisters] =
@@ -403,6 +469,7 @@ pre(!driversPowered)
 	axisNumber = p_driverNumber;										// axes are mapped straight through to drivers initially
 	driverBit = DriversBitmap::MakeFromBits(p_driverNumber);
 	enabled = false;
+	lastFaultBits = 0;
 	registersToUpdate = newRegistersToUpdate = 0;
 	motorCurrent = 0;
 	standstillCurrentFraction = 181; 									// default to 1/sqrt(2)
@@ -422,16 +489,30 @@ pre(!driversPowered)
 	SetStallDetectThreshold(DefaultStallDetectThreshold);				// this also updates the CoolConf register
 	SetStallMinimumStepsPerSecond(DefaultMinimumStepsPerSecond);
 	UpdateRegister(WritePwmConf, DefaultPwmConfReg);
+	SetMicrostepTable(SmartDrivers::DefaultMsLut, SmartDrivers::DefaultMsLutSel, SmartDrivers::DefaultMsLutStart);
 
 	for (size_t i = 0; i < NumReadRegisters; ++i)
 	{
 		accumulatedReadRegisters[i] = readRegisters[i] = 0;
 	}
 
-	regIndexBeingUpdated = regIndexRequested = previousRegIndexRequested = NoRegIndex;
+	regIndexBeingUpdated = regIndexRequested = previousRegIndexRequested = captureRegIndex = NoRegIndex;
+	captureTStepNext = false;
+	lastTStep = 0;
 	numReads = numWrites = 0;
 }
 
+// Set the microstep table
+void TmcDriverState::SetMicrostepTable(const uint32_t *msLut, uint32_t msLutSel, uint32_t msLutStart)
+{
+	for (size_t i = 0; i < SmartDrivers::NumMsLutRegisters; ++i)
+	{
+		UpdateRegister(WriteMsLut0 + i, msLut[i]);
+	}
+	UpdateRegister(WriteMsLutSel, msLutSel);
+	UpdateRegister(WriteMsLutStart, msLutStart);
+}
+
 // Set a register value and flag it for updating
 void TmcDriverState::UpdateRegister(size_t regIndex, uint32_t regVal)
 {
@@ -525,6 +606,12 @@ bool TmcDriverState::SetRegister(SmartDriverRegister reg, uint32_t regVal)
 		UpdateRegister (WriteTcoolthrs, regVal & ((1u << 20) - 1));
 		return true;
 
+	case SmartDriverRegister::coolConf:
+		// The lower 16 bits of COOLCONF configure coolStep. Current is reduced down to the SEIMIN fraction of IRUN when the load is light
+		// and raised back to IRUN when the load increases, so the configured motor current remains the upper bound.
+		UpdateRegister(WriteCoolConf, (writeRegisters[WriteCoolConf] & ~COOLCONF_COOLSTEP_MASK) | (regVal & COOLCONF_COOLSTEP_MASK));
+		return true;
+
 	case SmartDriverRegister::hdec:
 	default:
 		return false;
@@ -559,6 +646,9 @@ uint32_t TmcDriverState::GetRegister(SmartDriverRegister reg) const
 	case SmartDriverRegister::coolStep:
 		return writeRegisters[WriteTcoolthrs];
 
+	case SmartDriverRegister::coolConf:
+		return writeRegisters[WriteCoolConf] & COOLCONF_COOLSTEP_MASK;
+
 	case SmartDriverRegister::mstepPos:
 		return readRegisters[ReadMsCnt];
 
@@ -758,9 +848,20 @@ void TmcDriverState::AppendDriverStatus(const StringRef& reply, bool clearGlobal
 	{
 		reply.cat(", SG min/max not available");
 	}
+	if ((writeRegisters[WriteCoolConf] & COOLCONF_SEMIN_MASK) != 0 && minCsActual <= maxCsActual)
+	{
+		reply.catf(", coolstep current min/max %" PRIu32 "/%" PRIu32 "mA", CsActualToCurrent(minCsActual), CsActualToCurrent(maxCsActual));
+	}
 	ResetLoadRegisters();
 }
 
+// Convert a CS_ACTUAL value to the motor current in mA that it represents. IRUN corresponds to the configured motor current.
+uint32_t TmcDriverState::CsActualToCurrent(uint32_t csActual) const
+{
+	const uint32_t iRun = (writeRegisters[WriteIholdIrun] & IHOLDIRUN_IRUN_MASK) >> IHOLDIRUN_IRUN_SHIFT;
+	return (csActual >= iRun) ? motorCurrent : (motorCurrent * (csActual + 1))/(iRun + 1);
+}
+
 void TmcDriverState::SetStallDetectFilter(bool sgFilter)
 {
 	if (sgFilter)
@@ -800,11 +901,31 @@ void TmcDriverState::GetSpiCommand(uint8_t *sendDataBlock)
 		newRegistersToUpdate = 0;
 	}
 
+	captureRegIndex = NoRegIndex;
 	if (registersToUpdate == 0)
 	{
-		// Read a register
 		regIndexBeingUpdated = NoRegIndex;
 		regIndexRequested = (regIndexRequested >= NumReadRegisters - 1) ? 0 : regIndexRequested + 1;
+
+		// If we are capturing coil currents then use the slots in the read cycle that would read MSCNT and PWM_SCALE for the capture.
+		// GSTAT and DRV_STATUS are still read as often as usual, so fault reporting is not delayed. MSCNT and PWM_SCALE are not updated until the capture has finished.
+		static_assert(ReadGStat < ReadMsCnt && ReadDrvStat < ReadMsCnt && ReadPwmScale >= ReadMsCnt);
+		if (   regIndexRequested >= ReadMsCnt
+			&& numCoilCurrentSamplesTaken < numCoilCurrentSamplesWanted
+			&& coilCurrentCaptureDrivers.Intersects(driverBit)
+		   )
+		{
+			captureRegIndex = (captureTStepNext) ? CaptureTStep : CaptureMsCurAct;
+			captureTStepNext = coilCurrentCaptureTStep && !captureTStepNext;
+			sendDataBlock[0] = (captureRegIndex == CaptureTStep) ? REGNUM_TSTEP : REGNUM_MSCURACT;
+			sendDataBlock[1] = 0;
+			sendDataBlock[2] = 0;
+			sendDataBlock[3] = 0;
+			sendDataBlock[4] = 0;
+			return;
+		}
+
+		// Read a register
 		sendDataBlock[0] = ReadRegNumbers[regIndexRequested];
 		sendDataBlock[1] = 0;
 		sendDataBlock[2] = 0;
@@ -852,6 +973,15 @@ void TmcDriverState::TransferSucceeded(const uint8_t *rcvDataBlock)
 				{
 					maxSgLoadRegister = sgResult;
 				}
+				const uint32_t csActual = (regVal & TMC_RR_CSACTUAL_MASK) >> TMC_RR_CSACTUAL_SHIFT;
+				if (csActual < minCsActual)
+				{
+					minCsActual = csActual;
+				}
+				if (csActual > maxCsActual)
+				{
+					maxCsActual = csActual;
+				}
 			}
 
 			if ((regVal & (TMC_RR_OLA | TMC_RR_OLB)) != 0)
@@ -871,6 +1001,19 @@ void TmcDriverState::TransferSucceeded(const uint8_t *rcvDataBlock)
 			readRegisters[ReadDrvStat] = regVal;
 			regVal &= oldDrvStat;
 			accumulatedReadRegisters[ReadDrvStat] |= regVal;
+
+			// If the fault status has changed, flag this driver to the main task
+			const uint32_t faultBits = regVal & FaultStatusBits;
+			if (faultBits != lastFaultBits)
+			{
+				lastFaultBits = faultBits;
+				TaskCriticalSectionLocker lock;
+				if (driversWithChangedFaults.IsEmpty())
+				{
+					whenFaultsChanged = StepTimer::GetTimerTicks();
+				}
+				driversWithChangedFaults |= driverBit;
+			}
 		}
 		else
 		{
@@ -878,6 +1021,26 @@ void TmcDriverState::TransferSucceeded(const uint8_t *rcvDataBlock)
 			accumulatedReadRegisters[previousRegIndexRequested] |= regVal;
 		}
 	}
+	else if (previousRegIndexRequested == CaptureTStep)
+	{
+		lastTStep = LoadBE32(rcvDataBlock + 1) & TSTEP_MASK;
+	}
+	else if (previousRegIndexRequested == CaptureMsCurAct)
+	{
+		// This task is the only one that adds samples, so we don't need a critical section
+		const unsigned int sampleNumber = numCoilCurrentSamplesTaken;
+		if (sampleNumber < numCoilCurrentSamplesWanted)
+		{
+			const uint32_t regVal = LoadBE32(rcvDataBlock + 1);
+			CoilCurrentSample& sample = coilCurrentSamples[sampleNumber];
+			sample.whenRequested = captureRequestTime;
+			sample.tStep = lastTStep;
+			sample.currentA = SignExtend9(regVal & MSCURACT_CUR_A_MASK);
+			sample.currentB = SignExtend9((regVal >> MSCURACT_CUR_B_SHIFT) & MSCURACT_CUR_A_MASK);
+			sample.driver = driverBit.LowestSetBit();
+			numCoilCurrentSamplesTaken = sampleNumber + 1;
+		}
+	}
 
 	// Deal with the stall status
 	if (   (rcvDataBlock[0] & (1u << 2)) != 0							// if the status indicates stalled
@@ -892,12 +1055,20 @@ void TmcDriverState::TransferSucceeded(const uint8_t *rcvDataBlock)
 		readRegisters[ReadDrvStat] &= ~TMC_RR_SG;
 	}
 
-	previousRegIndexRequested = (regIndexBeingUpdated == NoRegIndex) ? regIndexRequested : NoRegIndex;
+	if (captureRegIndex != NoRegIndex)
+	{
+		previousRegIndexRequested = captureRegIndex;
+		captureRequestTime = StepTimer::GetTimerTicks();				// the driver latched the value when CS went high at the end of this transfer
+	}
+	else
+	{
+		previousRegIndexRequested = (regIndexBeingUpdated == NoRegIndex) ? regIndexRequested : NoRegIndex;
+	}
 }
 
 void TmcDriverState::TransferFailed()
 {
-	regIndexRequested = previousRegIndexRequested = NoRegIndex;
+	regIndexRequested = previousRegIndexRequested = captureRegIndex = NoRegIndex;
 }
 
 // State structures for all drivers
@@ -1387,6 +1558,16 @@ uint32_t SmartDrivers::GetAccumulatedStatus(size_t driver, uint32_t bitsToKeep)
 	return (driver < numTmc51xxDrivers) ? driverStates[driver].ReadAccumulatedStatus(bitsToKeep) : 0;
 }
 
+// Return the drivers whose fault status has changed since the last call, and the step clock when the first of those changes was seen
+DriversBitmap SmartDrivers::GetDriversWithChangedFaults(uint32_t& whenChanged)
+{
+	TaskCriticalSectionLocker lock;
+	const DriversBitmap ret = driversWithChangedFaults;
+	driversWithChangedFaults.Clear();
+	whenChanged = whenFaultsChanged;
+	return ret;
+}
+
 // Set microstepping and microstep interpolation
 bool SmartDrivers::SetMicrostepping(size_t driver, unsigned int microsteps, bool interpolate)
 {
@@ -1528,11 +1709,81 @@ bool SmartDrivers::SetRegister(size_t driver, SmartDriverRegister reg, uint32_t
 	return (driver < numTmc51xxDrivers) && driverStates[driver].SetRegister(reg, regVal);
 }
 
+// Set the microstep table, for example to compensate for microstep position errors of the motor
+void SmartDrivers::SetMicrostepTable(size_t driver, const uint32_t *msLut, uint32_t msLutSel, uint32_t msLutStart)
+{
+	if (driver < numTmc51xxDrivers)
+	{
+		driverStates[driver].SetMicrostepTable(msLut, msLutSel, msLutStart);
+	}
+}
+
 uint32_t SmartDrivers::GetRegister(size_t driver, SmartDriverRegister reg)
 {
 	return (driver < numTmc51xxDrivers) ? driverStates[driver].GetRegister(reg) : 0;
 }
 
+// Start capturing coil currents from the specified drivers. Return true if successful.
+bool SmartDrivers::StartCoilCurrentCapture(DriversBitmap drivers, unsigned int numSamples, bool withTStep, const StringRef& reply)
+{
+	if (numCoilCurrentSamplesTaken < numCoilCurrentSamplesWanted)
+	{
+		reply.copy("Coil current capture already in progress");
+		return false;
+	}
+
+	drivers &= DriversBitmap::MakeLowestNBits(numTmc51xxDrivers);
+	if (drivers.IsEmpty() || numSamples == 0)
+	{
+		reply.copy("No drivers or samples requested");
+		return false;
+	}
+
+	if (coilCurrentSamples == nullptr)
+	{
+		coilCurrentSamples = new CoilCurrentSample[MaxCoilCurrentSamples];
+	}
+
+	TaskCriticalSectionLocker lock;
+	coilCurrentCaptureDrivers = drivers;
+	coilCurrentCaptureTStep = withTStep;
+	numCoilCurrentSamplesTaken = 0;
+	numCoilCurrentSamplesWanted = min<unsigned int>(numSamples, MaxCoilCurrentSamples);
+	reply.printf("Capturing %u coil current samples", numCoilCurrentSamplesWanted);
+	return true;
+}
+
+// Append a block of captured coil current samples starting at the specified one. Each line gives the sample number, driver number,
+// step clocks since the first sample, the coil A and B currents, and TSTEP if it was captured. Return false if there is nothing to report.
+bool SmartDrivers::AppendCoilCurrentCapture(unsigned int firstSample, const StringRef& reply)
+{
+	const unsigned int numWanted = numCoilCurrentSamplesWanted;
+	const unsigned int numTaken = numCoilCurrentSamplesTaken;
+	if (coilCurrentSamples == nullptr || numWanted == 0)
+	{
+		reply.copy("No coil current samples captured");
+		return false;
+	}
+	if (numTaken < numWanted)
+	{
+		reply.printf("Coil current capture in progress, %u of %u samples taken", numTaken, numWanted);
+		return true;
+	}
+
+	reply.printf("Coil current samples %u", numTaken);
+	const unsigned int lastSample = min<unsigned int>(firstSample + MaxCoilCurrentSamplesPerReply, numTaken);
+	for (unsigned int i = firstSample; i < lastSample; ++i)
+	{
+		const CoilCurrentSample& sample = coilCurrentSamples[i];
+		reply.lcatf("%u %u %" PRIu32 " %d %d", i, sample.driver, sample.whenRequested - coilCurrentSamples[0].whenRequested, sample.currentA, sample.currentB);
+		if (coilCurrentCaptureTStep)
+		{
+			reply.catf(" %" PRIu32, sample.tStep);
+		}
+	}
+	return true;
+}
+
 #endif
 
 // End
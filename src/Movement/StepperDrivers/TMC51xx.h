@@ -23,9 +23,17 @@ const uint32_t TMC_RR_OLA = 1 << 29;				// open load A
 const uint32_t TMC_RR_OLB = 1 << 30;				// open load B
 const uint32_t TMC_RR_STST = 1 << 31;				// standstill detected
 const uint32_t TMC_RR_SGRESULT = 0x3FF;				// 10-bit stallGuard2 result
+const uint32_t TMC_RR_CSACTUAL_SHIFT = 16;
+const uint32_t TMC_RR_CSACTUAL_MASK = 31 << TMC_RR_CSACTUAL_SHIFT;	// actual current scale, reduced from IRUN by coolStep
 
 namespace SmartDrivers
 {
+	// Microstep table registers and their power-up values, which give a sine wave with amplitude 248
+	constexpr size_t NumMsLutRegisters = 8;
+	constexpr uint32_t DefaultMsLut[NumMsLutRegisters] = { 0xAAAAB554, 0x4A9554AA, 0x24492929, 0x10104222, 0xFBFFFFFF, 0xB5BB777D, 0x49295556, 0x00404222 };
+	constexpr uint32_t DefaultMsLutSel = 0xFFFF8056;
+	constexpr uint32_t DefaultMsLutStart = 0x00F70000;
+
 	void Init();
 	void Spin(bool powered);
 	void TurnDriversOff();
@@ -36,6 +44,7 @@ namespace SmartDrivers
 	void EnableDrive(size_t driver, bool en);
 	uint32_t GetLiveStatus(size_t driver);
 	uint32_t GetAccumulatedStatus(size_t drive, uint32_t bitsToKeep);
+	DriversBitmap GetDriversWithChangedFaults(uint32_t& whenChanged);
 	bool SetMicrostepping(size_t drive, unsigned int microsteps, bool interpolation);
 	unsigned int GetMicrostepping(size_t drive, bool& interpolation);
 	bool SetDriverMode(size_t driver, unsigned int mode);
@@ -49,6 +58,9 @@ namespace SmartDrivers
 	void SetStandstillCurrentPercent(size_t driver, float percent);
 	bool SetRegister(size_t driver, SmartDriverRegister reg, uint32_t regVal);
 	uint32_t GetRegister(size_t driver, SmartDriverRegister reg);
+	void SetMicrostepTable(size_t driver, const uint32_t *msLut, uint32_t msLutSel, uint32_t msLutStart);
+	bool StartCoilCurrentCapture(DriversBitmap drivers, unsigned int numSamples, bool withTStep, const StringRef& reply);
+	bool AppendCoilCurrentCapture(unsigned int firstSample, const StringRef& reply);
 };
 
 #endif
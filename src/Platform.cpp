@@ -18,13 +18,21 @@
 #include <CAN/CanInterface.h>
 #include <CanMessageBuffer.h>
 #include "Tasks.h"
+#include <TaskPriorities.h>
 #include "Heating/Heat.h"
 #include "Heating/Sensors/TemperatureSensor.h"
 #include "Fans/FansManager.h"
 #include <CanMessageFormats.h>
 #include <Hardware/Devices.h>
+#include <Hardware/EventLog.h>
+#include <Hardware/SavedSettings.h>
+#include <InputMonitors/InputMonitor.h>
 #include <Math/Isqrt.h>
 
+#if SUPPORT_THERMISTORS
+# include "Heating/Sensors/FixedPointLog.h"
+#endif
+
 #if SUPPORT_I2C_SENSORS && SUPPORT_LIS3DH
 # include <CommandProcessing/AccelerometerHandler.h>
 #endif
@@ -124,8 +132,10 @@ namespace Platform
 #   else
 	bool isSlowDriver = false;
 #   endif
+	static int8_t lastDirectionLevel = -1;								// the level we last set the direction pin of a slow driver to, or -1 if not known
 #  else
 	DriversBitmap slowDriversBitmap;
+	static DriversBitmap directionLevels, directionLevelsKnown;			// the levels we last set the direction pins of slow drivers to
 #  endif
 # endif
 
@@ -144,6 +154,24 @@ namespace Platform
 	static float motorCurrents[NumDrivers];
 	static float pressureAdvanceClocks[NumDrivers];
 	static float idleCurrentFactor[NumDrivers];
+
+# if HAS_SMART_DRIVERS
+	// Automatic current reduction between moves. The move task tells us when each driver's moves start and finish, and the main task reduces the current
+	// a configurable time after the last one has finished. A step timer callback wakes the auto idle task to restore the current a little before the next move starts,
+	// so that the restore doesn't depend on how often the main task gets round its loop.
+	constexpr uint32_t DefaultAutoIdleLeadClocks = (20 * StepTimer::StepClockRate)/1000;	// how long before a move we restore the current, must allow for the driver SPI update
+	constexpr uint32_t MaxAutoIdleAgeClocks = 1u << 30;										// we limit the time since the last move to this so that it doesn't wrap round
+	constexpr size_t AutoIdleTaskStackWords = 100;
+	static Task<AutoIdleTaskStackWords> *autoIdleTask = nullptr;							// created when automatic current reduction is first enabled
+	static StepTimer autoIdleTimer;
+	static uint32_t autoIdleDelayClocks = 0;												// how long after the last move finishes we reduce the current, 0 = don't
+	static uint32_t autoIdleLeadClocks = DefaultAutoIdleLeadClocks;
+	static float autoIdleCurrentFactor = 0.5;
+	static bool driverAtAutoIdleCurrent[NumDrivers];
+	static volatile uint32_t whenLastMoveFinishes[NumDrivers];								// local step clock time
+	static volatile uint32_t whenNextMoveStarts[NumDrivers];								// local step clock time, valid if restorePending is set
+	static volatile bool restorePending[NumDrivers];
+# endif
 #endif
 
 #if SUPPORT_SPI_SENSORS || defined(ATEIO)
@@ -171,14 +199,26 @@ namespace Platform
 	static float mcuTemperatureAdjust = 0.0;
 
 	static uint32_t lastPollTime;
-	static uint32_t lastFanCheckTime = 0;
+
+	// Startup timing for diagnostics, in milliseconds since the scheduler was started. Zero means that the phase hasn't been reached yet.
+	static uint32_t whenInitStarted = 0, whenDriversInitialised = 0, whenCanStarted = 0, whenDeferredInitCompleted = 0, whenFirstSynced = 0;
+#if SUPPORT_DRIVERS
+	constexpr uint32_t HiccupLogInterval = 60000;			// minimum interval between logging hiccup events, to limit wear on the event log
+	static uint32_t hiccupsLogged = 0;
+	static uint32_t whenHiccupsLastLogged = 0;
+#endif
 	static unsigned int heatTaskIdleTicks = 0;
 
 	constexpr uint32_t GreenLedFlashTime = 100;				// how long the green LED stays on after we process a CAN message
 	static uint32_t whenLastCanMessageProcessed = 0;
 
 #if SUPPORT_THERMISTORS
+# if SAMC21 && SUPPORT_SDADC
+	static ThermistorAveragingFilter thermistorFilters[FirstSdAdcFilterIndex];
+	static SdAdcAveragingFilter sdAdcFilters[NumSdAdcFilters];
+# else
 	static ThermistorAveragingFilter thermistorFilters[NumThermistorFilters];
+# endif
 #endif
 
 #if HAS_VOLTAGE_MONITOR
@@ -204,6 +244,22 @@ namespace Platform
 	MillisTimer openLoadATimer, openLoadBTimer;
 	MillisTimer driversFanTimer;		// driver cooling fan timer
 	static uint8_t nextDriveToPoll;
+
+	// Thermal derating. When a driver keeps reporting over-temperature we reduce its run and standstill currents in steps, so that it has a chance
+	// to cool down before it reaches the shutdown temperature. Current is restored one step at a time once the warnings have stopped.
+	constexpr uint8_t ThermalDeratingStepPercent = 10;			// how much of the configured current we remove or restore in one step
+	constexpr uint8_t MinThermalDeratingPercent = 50;			// we never reduce the current below this percentage of the configured current
+	constexpr uint32_t ThermalDeratingInterval = 2000;			// minimum milliseconds between successive current reductions
+	constexpr uint32_t ThermalRecoveryInterval = 30000;			// milliseconds without a warning before we restore one step of current
+	static uint8_t thermalDeratingPercent[NumDrivers];
+	static uint16_t thermalWarningCounts[NumDrivers];			// how many polls found the driver over temperature
+	static uint32_t whenLastThermalWarning[NumDrivers];
+	static uint32_t whenLastDeratingChange[NumDrivers];
+
+	// Immediate reporting of driver faults to the main board
+	static uint32_t numDriverFaultReports = 0;
+	static uint32_t lastDriverFaultReportLatency = 0;			// microseconds from receiving the changed status from the driver to queueing the CAN message
+	static uint32_t maxDriverFaultReportLatency = 0;
 # endif
 
 # if HAS_SMART_DRIVERS && HAS_VOLTAGE_MONITOR
@@ -236,7 +292,274 @@ namespace Platform
 #if HAS_SMART_DRIVERS
 	static void UpdateMotorCurrent(size_t driver)
 	{
-		SmartDrivers::SetCurrent(driver, (driverAtIdleCurrent[driver]) ? motorCurrents[driver] * idleCurrentFactor[driver] : motorCurrents[driver]);
+		const float current = (driverAtIdleCurrent[driver]) ? motorCurrents[driver] * idleCurrentFactor[driver]
+								: (driverAtAutoIdleCurrent[driver]) ? motorCurrents[driver] * autoIdleCurrentFactor
+									: motorCurrents[driver];
+		SmartDrivers::SetCurrent(driver, current * (thermalDeratingPercent[driver] * 0.01f));
+	}
+
+	// Reduce the current of drivers that have finished moving. Called by the main task.
+	// The move task may call EnableDriveForMove at any time, so each check and the corresponding state change is done with task switching disabled.
+	static void CheckAutoIdle()
+	{
+		for (size_t driver = 0; driver < NumDrivers; ++driver)
+		{
+			TaskCriticalSectionLocker lock;
+			const uint32_t now = StepTimer::GetTimerTicks();		// read this after taking the lock so that a move added just before is accounted for
+
+			// An idle or enable command may restore the current of a driver that hasn't moved for a long time. Don't let the time since its last move wrap round, else we would never reduce the current again.
+			if ((int32_t)(now - whenLastMoveFinishes[driver]) >= (int32_t)MaxAutoIdleAgeClocks)
+			{
+				whenLastMoveFinishes[driver] = now - MaxAutoIdleAgeClocks;
+			}
+
+			if (   autoIdleDelayClocks != 0 && !driverAtAutoIdleCurrent[driver] && !driverAtIdleCurrent[driver] && !restorePending[driver]
+				&& (int32_t)(now - whenLastMoveFinishes[driver]) >= (int32_t)autoIdleDelayClocks
+			   )
+			{
+				driverAtAutoIdleCurrent[driver] = true;
+				UpdateMotorCurrent(driver);
+			}
+		}
+	}
+
+	// Restore the current of drivers whose next move starts within the lead time, and schedule the step timer callback for the next one to restore.
+	// Must be called with task switching disabled.
+	static void RestoreAutoIdleCurrents() noexcept
+	{
+		bool again;
+		do
+		{
+			again = false;
+			const uint32_t now = StepTimer::GetTimerTicks();
+			bool anyPending = false;
+			uint32_t earliestStart = 0;
+			for (size_t driver = 0; driver < NumDrivers; ++driver)
+			{
+				if (restorePending[driver])
+				{
+					if ((int32_t)(whenNextMoveStarts[driver] - now) <= (int32_t)autoIdleLeadClocks)
+					{
+						restorePending[driver] = false;
+						driverAtAutoIdleCurrent[driver] = false;
+						UpdateMotorCurrent(driver);
+					}
+					else if (!anyPending || (int32_t)(whenNextMoveStarts[driver] - earliestStart) < 0)
+					{
+						earliestStart = whenNextMoveStarts[driver];
+						anyPending = true;
+					}
+				}
+			}
+			if (anyPending)
+			{
+				again = autoIdleTimer.ScheduleCallback(earliestStart - autoIdleLeadClocks);		// returns true if the time is already due
+			}
+		} while (again);
+	}
+
+	static void AutoIdleTimerCallback(CallbackParameter) noexcept
+	{
+		autoIdleTask->GiveFromISR();
+	}
+
+	[[noreturn]] static void AutoIdleTaskLoop(void *) noexcept
+	{
+		for (;;)
+		{
+			TaskBase::Take();
+			TaskCriticalSectionLocker lock;
+			RestoreAutoIdleCurrents();
+		}
+	}
+
+	// The automatic current reduction settings as we keep them in EEPROM, so that they survive a reset of this board
+	struct SavedAutoIdleSettings
+	{
+		uint32_t delayMillis;
+		uint32_t leadMicroseconds;
+		uint8_t percent;
+		uint8_t spare[3];
+	};
+
+	// Apply automatic current reduction settings that have already been checked
+	static void ApplyAutoIdle(uint32_t delayMillis, uint32_t leadMicroseconds, uint8_t percent) noexcept
+	{
+		if (delayMillis != 0 && autoIdleTask == nullptr)
+		{
+			autoIdleTimer.SetCallback(AutoIdleTimerCallback, CallbackParameter(nullptr));
+			autoIdleTask = new Task<AutoIdleTaskStackWords>;
+			autoIdleTask->Create(AutoIdleTaskLoop, "AIDLE", nullptr, TaskPriority::AutoIdlePriority);
+		}
+
+		autoIdleCurrentFactor = (float)percent * 0.01;
+		autoIdleLeadClocks = (leadMicroseconds == 0) ? DefaultAutoIdleLeadClocks : (leadMicroseconds * (StepTimer::StepClockRate/1000))/1000;
+		for (size_t driver = 0; driver < NumDrivers; ++driver)
+		{
+			TaskCriticalSectionLocker lock;
+			const uint32_t now = StepTimer::GetTimerTicks();
+			if ((int32_t)(whenLastMoveFinishes[driver] - now) < 0)
+			{
+				whenLastMoveFinishes[driver] = now;				// don't count time from before we were enabled
+			}
+			if (driverAtAutoIdleCurrent[driver])
+			{
+				restorePending[driver] = false;
+				driverAtAutoIdleCurrent[driver] = false;
+				UpdateMotorCurrent(driver);
+			}
+		}
+		autoIdleDelayClocks = delayMillis * (StepTimer::StepClockRate/1000);
+	}
+
+	// Restore the automatic current reduction settings. Called from Init, so the motor currents have not been set yet.
+	static void LoadAutoIdle() noexcept
+	{
+		SavedAutoIdleSettings saved;
+		if (SavedSettings::Load(SavedSettings::Block::autoIdle, &saved, sizeof(saved)) && saved.percent <= 100 && saved.delayMillis <= 60000 && saved.leadMicroseconds <= 1000000)
+		{
+			ApplyAutoIdle(saved.delayMillis, saved.leadMicroseconds, saved.percent);
+		}
+	}
+
+	// Adjust the thermal derating of a driver. Called each time we poll the driver status.
+	static void UpdateThermalDerating(size_t driver, bool overTemperature)
+	{
+		const uint32_t now = millis();
+		if (overTemperature)
+		{
+			whenLastThermalWarning[driver] = now;
+			if (thermalWarningCounts[driver] < 0xFFFF)
+			{
+				++thermalWarningCounts[driver];
+			}
+			if (thermalDeratingPercent[driver] > MinThermalDeratingPercent && now - whenLastDeratingChange[driver] >= ThermalDeratingInterval)
+			{
+				if (thermalDeratingPercent[driver] == 100)
+				{
+					EventLog::Record(EventLog::EventType::driverDerated, driver);
+				}
+				thermalDeratingPercent[driver] = max<uint8_t>(thermalDeratingPercent[driver] - ThermalDeratingStepPercent, MinThermalDeratingPercent);
+				whenLastDeratingChange[driver] = now;
+				UpdateMotorCurrent(driver);
+			}
+		}
+		else if (   thermalDeratingPercent[driver] < 100
+				 && now - whenLastThermalWarning[driver] >= ThermalRecoveryInterval
+				 && now - whenLastDeratingChange[driver] >= ThermalRecoveryInterval
+				)
+		{
+			thermalDeratingPercent[driver] = min<uint8_t>(thermalDeratingPercent[driver] + ThermalDeratingStepPercent, 100);
+			whenLastDeratingChange[driver] = now;
+			UpdateMotorCurrent(driver);
+		}
+	}
+
+	// Send the status of all drivers to the main board because the fault status of at least one of them has changed.
+	// The latency is measured from when the driver status was received from the driver to when we queue the message.
+	static void ReportDriverFaults(uint32_t whenFaultsChanged)
+	{
+		CanMessageBuffer buf(nullptr);
+		BuildDriverStatusMessage(&buf);
+		const uint32_t latency = StepTimer::TicksToIntegerMicroseconds(StepTimer::GetTimerTicks() - whenFaultsChanged);
+		CanInterface::Send(&buf);
+		++numDriverFaultReports;
+		lastDriverFaultReportLatency = latency;
+		if (latency > maxDriverFaultReportLatency)
+		{
+			maxDriverFaultReportLatency = latency;
+		}
+	}
+
+	// Check the accumulated status of a TMC driver for temperature warning, temperature shutdown and other faults
+	static void CheckDriverStatus(size_t driver)
+	{
+		const uint32_t stat = SmartDrivers::GetAccumulatedStatus(driver, 0);
+		const DriversBitmap mask = DriversBitmap::MakeFromBits(driver);
+		if (stat & TMC_RR_OT)
+		{
+			temperatureShutdownDrivers |= mask;
+		}
+		else if (stat & TMC_RR_OTPW)
+		{
+			temperatureWarningDrivers |= mask;
+		}
+		UpdateThermalDerating(driver, (stat & (TMC_RR_OT | TMC_RR_OTPW)) != 0);
+		if (stat & TMC_RR_S2G)
+		{
+			shortToGroundDrivers |= mask;
+		}
+		else
+		{
+			shortToGroundDrivers &= ~mask;
+		}
+
+		// The driver often produces a transient open-load error, especially in stealthchop mode, so we require the condition to persist before we report it.
+		// Also, false open load indications persist when in standstill, if the phase has zero current in that position
+		if ((stat & TMC_RR_OLA) != 0)
+		{
+			if (!openLoadATimer.IsRunning())
+			{
+				openLoadATimer.Start();
+				openLoadADrivers.Clear();
+				notOpenLoadADrivers.Clear();
+			}
+			openLoadADrivers |= mask;
+		}
+		else if (openLoadATimer.IsRunning())
+		{
+			notOpenLoadADrivers |= mask;
+			if (openLoadADrivers.Disjoint(~notOpenLoadADrivers) )
+			{
+				openLoadATimer.Stop();
+			}
+		}
+
+		if ((stat & TMC_RR_OLB) != 0)
+		{
+			if (!openLoadBTimer.IsRunning())
+			{
+				openLoadBTimer.Start();
+				openLoadBDrivers.Clear();
+				notOpenLoadBDrivers.Clear();
+			}
+			openLoadBDrivers |= mask;
+		}
+		else if (openLoadBTimer.IsRunning())
+		{
+			notOpenLoadBDrivers |= mask;
+			if (openLoadBDrivers.Disjoint(~notOpenLoadBDrivers))
+			{
+				openLoadBTimer.Stop();
+			}
+		}
+
+# if HAS_STALL_DETECT
+		if ((stat & TMC_RR_SG) != 0)
+		{
+			if (stalledDrivers.Disjoint(mask))
+			{
+				// This stall is new so check whether we need to perform some action in response to the stall
+				if (rehomeOnStallDrivers.Intersects(mask))
+				{
+					stalledDriversToRehome |= mask;
+				}
+				else if (pauseOnStallDrivers.Intersects(mask))
+				{
+					stalledDriversToPause |= mask;
+				}
+				else if (logOnStallDrivers.Intersects(mask))
+				{
+					stalledDriversToLog |= mask;
+				}
+			}
+			stalledDrivers |= mask;
+		}
+		else
+		{
+			stalledDrivers &= ~mask;
+		}
+# endif
 	}
 #endif
 
@@ -452,12 +775,21 @@ namespace Platform
 #if SUPPORT_THERMISTORS
 	static void SetupThermistorFilter(Pin pin, size_t filterIndex, bool useAlternateAdc)
 	{
-		thermistorFilters[filterIndex].Init(0);
 #if SAMC21
 		const AdcInput adcChan = (useAlternateAdc) ? PinToSdAdcChannel(pin) : PinToAdcChannel(pin);
 #else
 		const AdcInput adcChan = PinToAdcChannel(pin);
 #endif
+#if SAMC21 && SUPPORT_SDADC
+		if (filterIndex >= FirstSdAdcFilterIndex)
+		{
+			SdAdcAveragingFilter& filter = sdAdcFilters[filterIndex - FirstSdAdcFilterIndex];
+			filter.Init(0);
+			AnalogIn::EnableChannel(adcChan, filter.CallbackFeedIntoFilter, &filter, 1, useAlternateAdc);
+			return;
+		}
+#endif
+		thermistorFilters[filterIndex].Init(0);
 		AnalogIn::EnableChannel(adcChan, thermistorFilters[filterIndex].CallbackFeedIntoFilter, &thermistorFilters[filterIndex], 1, useAlternateAdc);
 	}
 #endif
@@ -557,6 +889,7 @@ void Platform::WriteLed(uint8_t ledNumber, bool turnOn)
 // Initialisation
 void Platform::Init()
 {
+	whenInitStarted = millis();
 	IoPort::Init();
 
 #ifdef TOOL1LC
@@ -814,10 +1147,18 @@ void Platform::Init()
 		directions[i] = true;
 		driverAtIdleCurrent[i] = false;
 		idleCurrentFactor[i] = 0.3;
+# if HAS_SMART_DRIVERS
+		driverAtAutoIdleCurrent[i] = false;
+		restorePending[i] = false;
+		whenLastMoveFinishes[i] = 0;
+# endif
 		motorCurrents[i] = 0.0;
 		pressureAdvanceClocks[i] = 0.0;
 
 # if HAS_SMART_DRIVERS
+		thermalDeratingPercent[i] = 100;
+		thermalWarningCounts[i] = 0;
+		whenLastThermalWarning[i] = whenLastDeratingChange[i] = 0;
 		SmartDrivers::SetMicrostepping(i, 16, true);
 # endif
 	}
@@ -835,6 +1176,7 @@ void Platform::Init()
 # if HAS_SMART_DRIVERS && HAS_VOLTAGE_MONITOR
 	warnDriversNotPowered = false;
 # endif
+	whenDriversInitialised = millis();
 #endif	//SUPPORT_DRIVERS
 
 #if SUPPORT_SPI_SENSORS || defined(ATEIO)
@@ -873,6 +1215,19 @@ void Platform::Init()
 
 	InitialiseInterrupts();
 
+	EventLog::Init();
+	SavedSettings::Init();
+#if HAS_SMART_DRIVERS
+	LoadAutoIdle();
+#endif
+	CanInterface::Init(GetCanAddress(), UseAlternateCanPins, true);
+	lastPollTime = whenCanStarted = millis();
+}
+
+// Perform initialisation that isn't needed before we announce ourselves to the main board.
+// This is called by the main task after the other subsystems have been started, so that slow probing of optional devices doesn't delay the announcement.
+void Platform::InitDeferred()
+{
 #if SUPPORT_I2C_SENSORS && SUPPORT_LIS3DH
 # ifdef TOOL1LC
 	if (boardVariant != 0)
@@ -882,8 +1237,18 @@ void Platform::Init()
 	}
 #endif
 
-	CanInterface::Init(GetCanAddress(), UseAlternateCanPins, true);
-	lastPollTime = millis();
+	whenDeferredInitCompleted = millis();
+}
+
+// Append the times at which the startup phases completed
+void Platform::AppendStartupTimes(const StringRef& reply)
+{
+	reply.lcatf("Startup times (ms, 0 = not yet): init started %" PRIu32, whenInitStarted);
+#if SUPPORT_DRIVERS
+	reply.catf(", drivers %" PRIu32, whenDriversInitialised);
+#endif
+	reply.catf(", CAN %" PRIu32 ", deferred init %" PRIu32 ", announce acknowledged %" PRIu32 ", synced %" PRIu32,
+				whenCanStarted, whenDeferredInitCompleted, CanInterface::GetWhenAnnounceAcknowledged(), whenFirstSynced);
 }
 
 // Perform minimal initialisation prior to updating the bootloader
@@ -950,6 +1315,11 @@ void Platform::Spin()
 
 	SpinMinimal();				// update the activity LED and currentVin
 
+	if (whenFirstSynced == 0 && StepTimer::IsSynced())
+	{
+		whenFirstSynced = millis();
+	}
+
 #if HAS_VOLTAGE_MONITOR
 	const float voltsVin = GetCurrentVinVoltage();
 #endif
@@ -965,6 +1335,7 @@ void Platform::Spin()
 	{
 		powered = false;
 		++numUnderVoltageEvents;
+		EventLog::Record(EventLog::EventType::underVoltage, 0, (uint32_t)(voltsVin * 1000));
 	}
 #elif HAS_VOLTAGE_MONITOR
 
@@ -975,100 +1346,32 @@ void Platform::Spin()
 	else if (powered && voltsVin < 10.0)
 	{
 		powered = false;
+		EventLog::Record(EventLog::EventType::underVoltage, 0, (uint32_t)(voltsVin * 1000));
 	}
 #endif
 
 #if HAS_SMART_DRIVERS
 	SmartDrivers::Spin(powered);
 
-	// Check one TMC driver for temperature warning or temperature shutdown
-	if (enableValues[nextDriveToPoll] >= 0)				// don't poll driver if it is flagged "no poll"
+	// Deal straight away with any drivers whose fault status has changed, then check one more driver so that the open load timers and thermal derating recovery keep going
+	uint32_t whenFaultsChanged;
+	const DriversBitmap driversWithChangedFaults = SmartDrivers::GetDriversWithChangedFaults(whenFaultsChanged);
+	if (!driversWithChangedFaults.IsEmpty())
 	{
-		const uint32_t stat = SmartDrivers::GetAccumulatedStatus(nextDriveToPoll, 0);
-		const DriversBitmap mask = DriversBitmap::MakeFromBits(nextDriveToPoll);
-		if (stat & TMC_RR_OT)
-		{
-			temperatureShutdownDrivers |= mask;
-		}
-		else if (stat & TMC_RR_OTPW)
-		{
-			temperatureWarningDrivers |= mask;
-		}
-		if (stat & TMC_RR_S2G)
-		{
-			shortToGroundDrivers |= mask;
-		}
-		else
-		{
-			shortToGroundDrivers &= ~mask;
-		}
-
-		// The driver often produces a transient open-load error, especially in stealthchop mode, so we require the condition to persist before we report it.
-		// Also, false open load indications persist when in standstill, if the phase has zero current in that position
-		if ((stat & TMC_RR_OLA) != 0)
-		{
-			if (!openLoadATimer.IsRunning())
-			{
-				openLoadATimer.Start();
-				openLoadADrivers.Clear();
-				notOpenLoadADrivers.Clear();
-			}
-			openLoadADrivers |= mask;
-		}
-		else if (openLoadATimer.IsRunning())
-		{
-			notOpenLoadADrivers |= mask;
-			if (openLoadADrivers.Disjoint(~notOpenLoadADrivers) )
-			{
-				openLoadATimer.Stop();
-			}
-		}
-
-		if ((stat & TMC_RR_OLB) != 0)
-		{
-			if (!openLoadBTimer.IsRunning())
-			{
-				openLoadBTimer.Start();
-				openLoadBDrivers.Clear();
-				notOpenLoadBDrivers.Clear();
-			}
-			openLoadBDrivers |= mask;
-		}
-		else if (openLoadBTimer.IsRunning())
-		{
-			notOpenLoadBDrivers |= mask;
-			if (openLoadBDrivers.Disjoint(~notOpenLoadBDrivers))
-			{
-				openLoadBTimer.Stop();
-			}
-		}
+		driversWithChangedFaults.Iterate([](unsigned int driver, unsigned int count) -> void
+											{
+												if (enableValues[driver] >= 0)
+												{
+													CheckDriverStatus(driver);
+												}
+											}
+										);
+		ReportDriverFaults(whenFaultsChanged);
+	}
 
-# if HAS_STALL_DETECT
-		if ((stat & TMC_RR_SG) != 0)
-		{
-			if (stalledDrivers.Disjoint(mask))
-			{
-				// This stall is new so check whether we need to perform some action in response to the stall
-				if (rehomeOnStallDrivers.Intersects(mask))
-				{
-					stalledDriversToRehome |= mask;
-				}
-				else if (pauseOnStallDrivers.Intersects(mask))
-				{
-					stalledDriversToPause |= mask;
-				}
-				else if (logOnStallDrivers.Intersects(mask))
-				{
-					stalledDriversToLog |= mask;
-				}
-			}
-			stalledDrivers |= mask;
-		}
-		else
-		{
-			stalledDrivers &= ~mask;
-		}
-# endif
+	if (enableValues[nextDriveToPoll] >= 0)				// don't poll driver if it is flagged "no poll"
+	{
+		CheckDriverStatus(nextDriveToPoll);
 	}
 
 # if 0 //HAS_STALL_DETECT
@@ -1097,14 +1400,14 @@ void Platform::Spin()
 	}
 #endif
 
-	// Thermostatically-controlled fans (do this after getting TMC driver status)
+	// Update the fan PWMs. The heat task calculates the demand of thermostatic fans when it polls the sensors.
+	(void)FansManager::CheckFans();
+
+#if HAS_SMART_DRIVERS
+	CheckAutoIdle();
+#endif
+
 	const uint32_t now = millis();
-	const bool checkSensors = (now - lastFanCheckTime >= FanCheckInterval);
-	(void)FansManager::CheckFans(checkSensors);
-	if (checkSensors)
-	{
-		lastFanCheckTime = now;
-	}
 
 	// Update the Diag LED. Flash it quickly (8Hz) if we are not synced to the master, else flash in sync with the master (about 2Hz).
 	WriteLed(0,
@@ -1211,6 +1514,21 @@ void Platform::Spin()
 #endif
 		}
 
+		// Log any CAN bus off events and step interrupt hiccups that have occurred
+		CanInterface::CheckForBusOff();
+#if SUPPORT_DRIVERS
+		if (now - whenHiccupsLastLogged >= HiccupLogInterval)
+		{
+			const uint32_t totalHiccups = moveInstance->GetTotalHiccups();
+			if (totalHiccups != hiccupsLogged)
+			{
+				EventLog::Record(EventLog::EventType::hiccups, 0, totalHiccups - hiccupsLogged);
+				hiccupsLogged = totalHiccups;
+				whenHiccupsLastLogged = now;
+			}
+		}
+#endif
+
 #ifdef SAMMYC21
 		//debugPrintf("IR=%" PRIx32 " ERR=%" PRIx32 " RXF0S=%" PRIx32 " RXF1S=%" PRIx32 " PSR=%" PRIx32 " CCCR=%" PRIx32 "\n",
 		//	CAN0->IR.reg, CAN0->ECR.reg, CAN0->RXF0S.reg, CAN0->RXF1S.reg, CAN0->PSR.reg, CAN0->CCCR.reg);
@@ -1238,6 +1556,9 @@ void Platform::Spin()
 		}
 #endif
 	}
+
+	EventLog::Spin();
+	SavedSettings::Spin();
 }
 
 void Platform::SpinMinimal()
@@ -1271,32 +1592,74 @@ int Platform::GetAveragingFilterIndex(const IoPort& port)
 	return -1;
 }
 
-ThermistorAveragingFilter *Platform::GetAdcFilter(unsigned int filterNumber)
+void Platform::InitAdcFilter(unsigned int filterNumber, uint16_t val)
+{
+# if SAMC21 && SUPPORT_SDADC
+	if (filterNumber >= FirstSdAdcFilterIndex)
+	{
+		sdAdcFilters[filterNumber - FirstSdAdcFilterIndex].Init(val);
+		return;
+	}
+# endif
+	thermistorFilters[filterNumber].Init(val);
+}
+
+bool Platform::IsAdcFilterValid(unsigned int filterNumber)
+{
+# if SAMC21 && SUPPORT_SDADC
+	if (filterNumber >= FirstSdAdcFilterIndex)
+	{
+		return sdAdcFilters[filterNumber - FirstSdAdcFilterIndex].IsValid();
+	}
+# endif
+	return thermistorFilters[filterNumber].IsValid();
+}
+
+// Get the average of the readings in a filter, scaled to AnalogIn::AdcBits + oversampleBits bits whatever the filter length.
+// SDADC readings arrive already scaled to AnalogIn::AdcBits, so they have the same resolution as ADC readings here.
+uint32_t Platform::GetAveragedAdcReading(unsigned int filterNumber, unsigned int oversampleBits)
 {
-	return &thermistorFilters[filterNumber];
+# if SAMC21 && SUPPORT_SDADC
+	if (filterNumber >= FirstSdAdcFilterIndex)
+	{
+		return sdAdcFilters[filterNumber - FirstSdAdcFilterIndex].GetSum()/(SdAdcAveragingFilter::NumAveraged() >> oversampleBits);
+	}
+# endif
+	return thermistorFilters[filterNumber].GetSum()/(ThermistorAveragingFilter::NumAveraged() >> oversampleBits);
+}
+
+uint16_t Platform::GetLatestAdcReading(unsigned int filterNumber)
+{
+# if SAMC21 && SUPPORT_SDADC
+	if (filterNumber >= FirstSdAdcFilterIndex)
+	{
+		return sdAdcFilters[filterNumber - FirstSdAdcFilterIndex].GetLatestReading();
+	}
+# endif
+	return thermistorFilters[filterNumber].GetLatestReading();
 }
 
 #endif
 
 #if HAS_VREF_MONITOR
 
-ThermistorAveragingFilter *Platform::GetVssaFilter(unsigned int filterNumber)
+int Platform::GetVssaFilterIndex(unsigned int filterNumber)
 {
 #if SAMC21
 	// The SDADC channel has INN connected to VSSA and no separate VSSA monitor
-	return (filterNumber < NumThermistorInputs) ? &thermistorFilters[VssaFilterIndex] : nullptr;
+	return (filterNumber < NumThermistorInputs) ? (int)VssaFilterIndex : -1;
 #else
-	return &thermistorFilters[VssaFilterIndex];
+	return (int)VssaFilterIndex;
 #endif
 }
 
-ThermistorAveragingFilter *Platform::GetVrefFilter(unsigned int filterNumber)
+unsigned int Platform::GetVrefFilterIndex(unsigned int filterNumber)
 {
 #if SAMC21
 	// The SDADC channel has a separate VSSA monitor
-	return (filterNumber == SdAdcTemp0FilterIndex) ? &thermistorFilters[SdAdcVrefFilterIndex] : &thermistorFilters[VrefFilterIndex];
+	return (filterNumber == SdAdcTemp0FilterIndex) ? SdAdcVrefFilterIndex : VrefFilterIndex;
 #else
-	return &thermistorFilters[VrefFilterIndex];
+	return VrefFilterIndex;
 #endif
 }
 
@@ -1321,6 +1684,7 @@ uint32_t Platform::GetHeatTaskIdleTicks()
 
 void Platform::HandleHeaterFault(unsigned int heater)
 {
+	EventLog::Record(EventLog::EventType::heaterFault, heater);
 	//TODO report the heater fault to the main board
 }
 
@@ -1507,8 +1871,10 @@ void Platform::SetDriverStepTiming(size_t drive, const float timings[4])
 
 #  if SINGLE_DRIVER
 	isSlowDriver = isSlow;
+	lastDirectionLevel = -1;						// we don't track the direction level of fast drivers
 #  else
 	slowDriversBitmap.SetOrClearBit(drive, isSlow);
+	directionLevelsKnown.ClearBit(drive);			// we don't track the direction levels of fast drivers
 #  endif
 }
 
@@ -1524,11 +1890,10 @@ void Platform::SetPressureAdvance(size_t driver, float advance)
 	pressureAdvanceClocks[driver] = advance * (float)StepTimer::StepClockRate;
 }
 
-#if 0	// not used yet and may never be
-// Send the status of drivers and filament monitors to the main board
+// Build a message giving the status of the drivers, to send to the main board
 void Platform::BuildDriverStatusMessage(CanMessageBuffer *buf) noexcept
 {
-	auto msg = buf->SetupStatusMessage<CanMessageDriversStatus>(CanInterface::GetCanAddress(), CanId::MasterAddress);
+	auto msg = buf->SetupStatusMessage<CanMessageDriversStatus>(CanInterface::GetCanAddress(), CanInterface::GetCurrentMasterAddress());
 	for (size_t drive = 0; drive < NumDrivers; ++drive)
 	{
 		const uint32_t driverStat =
@@ -1543,7 +1908,6 @@ void Platform::BuildDriverStatusMessage(CanMessageBuffer *buf) noexcept
 	msg->zero = 0;
 	buf->dataLength = msg->GetActualDataLength();
 }
-#endif
 
 void Platform::SetDirectionValue(size_t drive, bool dVal)
 {
@@ -1573,6 +1937,12 @@ void Platform::SetDirection(bool direction)
 # if SUPPORT_SLOW_DRIVERS
 	if (isSlowDriver)
 	{
+		// If the direction was set in advance by Move::PresetDirections then we must not restart the direction setup time
+		if ((int8_t)d == lastDirectionLevel)
+		{
+			return;
+		}
+		lastDirectionLevel = (int8_t)d;
 #  if USE_TC_FOR_STEP
 		while (StepTimer::GetTimerTicks() - DDA::lastStepHighTime < GetSlowDriverDirHoldFromLeadingEdgeClocks()) { }
 #  else
@@ -1610,6 +1980,21 @@ void Platform::SetDirection(size_t driver, bool direction)
 		const bool isSlowDriver = slowDriversBitmap.IsBitSet(driver);
 		if (isSlowDriver)
 		{
+			// If the direction was set in advance by Move::PresetDirections then we must not restart the direction setup time
+			const DriversBitmap mask = DriversBitmap::MakeFromBits(driver);
+			if (directionLevelsKnown.Intersects(mask) && directionLevels.Intersects(mask) == d)
+			{
+				return;
+			}
+			directionLevelsKnown |= mask;
+			if (d)
+			{
+				directionLevels |= mask;
+			}
+			else
+			{
+				directionLevels &= ~mask;
+			}
 			while (StepTimer::GetTimerTicks() - DDA::lastStepLowTime < GetSlowDriverDirHoldClocks()) { }
 		}
 # endif
@@ -1655,10 +2040,14 @@ int8_t Platform::GetEnableValue(size_t driver)
 void Platform::EnableDrive(size_t driver)
 {
 # if HAS_SMART_DRIVERS
-	if (driverAtIdleCurrent[driver])
 	{
-		driverAtIdleCurrent[driver] = false;
-		UpdateMotorCurrent(driver);
+		TaskCriticalSectionLocker lock;
+		if (driverAtIdleCurrent[driver] || (driverAtAutoIdleCurrent[driver] && !restorePending[driver]))
+		{
+			driverAtIdleCurrent[driver] = false;
+			driverAtAutoIdleCurrent[driver] = false;
+			UpdateMotorCurrent(driver);
+		}
 	}
 	SmartDrivers::EnableDrive(driver, true);
 # else
@@ -1672,6 +2061,27 @@ void Platform::EnableDrive(size_t driver)
 # endif
 }
 
+// Enable a driver for a move that starts and finishes at the specified local step clock times. Called by the move task when it adds a move to the DDA ring.
+// If the driver's current was reduced automatically, we leave it reduced until shortly before the move starts.
+// The main task reduces the current in CheckAutoIdle, so we must not let it run between checking the state and recording the new move.
+// The auto idle task restores it, or we do it here if the move starts too soon for that.
+void Platform::EnableDriveForMove(size_t driver, uint32_t startTime, uint32_t finishTime)
+{
+# if HAS_SMART_DRIVERS
+	{
+		TaskCriticalSectionLocker lock;
+		if (driverAtAutoIdleCurrent[driver] && !driverAtIdleCurrent[driver] && !restorePending[driver])
+		{
+			whenNextMoveStarts[driver] = startTime;
+			restorePending[driver] = true;
+			RestoreAutoIdleCurrents();					// restores the current now if the move starts within the lead time, else schedules the restore
+		}
+		whenLastMoveFinishes[driver] = finishTime;
+	}
+# endif
+	EnableDrive(driver);
+}
+
 void Platform::DisableDrive(size_t driver)
 {
 # if HAS_SMART_DRIVERS
@@ -1690,6 +2100,10 @@ void Platform::DisableDrive(size_t driver)
 void Platform::SetDriverIdle(size_t driver, uint8_t percent)
 {
 	idleCurrentFactor[driver] = (float)percent * 0.01;
+# if HAS_SMART_DRIVERS
+	driverAtAutoIdleCurrent[driver] = false;
+	restorePending[driver] = false;
+# endif
 	if (percent == 0)
 	{
 		DisableDrive(driver);
@@ -1717,12 +2131,75 @@ void Platform::DisableAllDrives()
 
 # if HAS_SMART_DRIVERS
 
+// Configure automatic current reduction between moves. A delay of zero turns it off.
+GCodeResult Platform::SetAutoIdle(uint32_t delayMillis, uint32_t leadMicroseconds, uint8_t percent, const StringRef& reply)
+{
+	if (delayMillis == 0 && leadMicroseconds == 0 && percent == 0)
+	{
+		reply.copy("Automatic idle current");
+		AppendAutoIdleStatus(reply);
+		return GCodeResult::ok;
+	}
+
+	if (percent > 100 || delayMillis > 60000 || leadMicroseconds > 1000000)
+	{
+		reply.copy("Automatic idle parameter out of range");
+		return GCodeResult::error;
+	}
+
+	ApplyAutoIdle(delayMillis, leadMicroseconds, percent);
+
+	SavedAutoIdleSettings saved;
+	memset(&saved, 0, sizeof(saved));
+	saved.delayMillis = delayMillis;
+	saved.leadMicroseconds = leadMicroseconds;
+	saved.percent = percent;
+	SavedSettings::Save(SavedSettings::Block::autoIdle, &saved, sizeof(saved));
+	return GCodeResult::ok;
+}
+
+// Append the automatic current reduction settings, for M122
+void Platform::AppendAutoIdleStatus(const StringRef& reply)
+{
+	if (autoIdleDelayClocks == 0)
+	{
+		reply.cat(" disabled");
+	}
+	else
+	{
+		reply.catf(" %d%% after %" PRIu32 "ms, restored %" PRIu32 "us before moving",
+					(int)lrintf(autoIdleCurrentFactor * 100.0), (autoIdleDelayClocks * 1000)/StepTimer::StepClockRate, StepTimer::TicksToIntegerMicroseconds(autoIdleLeadClocks));
+	}
+	if (!SavedSettings::IsAvailable())
+	{
+		reply.cat(" (not saved, no EEPROM)");
+	}
+}
+
 void Platform::SetMotorCurrent(size_t driver, float current)
 {
 	motorCurrents[driver] = current;
 	UpdateMotorCurrent(driver);
 }
 
+// Append the thermal derating state of a driver, if it has ever been too hot
+void Platform::AppendThermalDerating(size_t driver, const StringRef& reply)
+{
+	if (thermalWarningCounts[driver] != 0)
+	{
+		reply.catf(", current %u%%, over temperature %u times, last %" PRIu32 "s ago",
+					thermalDeratingPercent[driver], thermalWarningCounts[driver], (millis() - whenLastThermalWarning[driver])/1000);
+	}
+}
+
+// Append the number of driver fault reports we have sent and how long it took to send them, then reset the maximum
+void Platform::AppendDriverFaultReports(const StringRef& reply)
+{
+	reply.lcatf("Driver fault reports %" PRIu32 ", latency last %" PRIu32 "us max %" PRIu32 "us",
+				numDriverFaultReports, lastDriverFaultReportLatency, maxDriverFaultReportLatency);
+	maxDriverFaultReportLatency = 0;
+}
+
 # endif
 
 #endif	//SUPPORT_DRIVERS
@@ -1856,6 +2333,42 @@ static uint32_t TimedSqrt(uint64_t arg, uint32_t& timeAcc) noexcept
 	return ret;
 }
 
+#if SUPPORT_THERMISTORS
+
+// Execute a timed natural log of a ratio of ADC readings using the floating point library, as used by the thermistor code on boards with a FPU
+static float TimedFloatLogRatio(uint32_t num, uint32_t den, uint32_t& timeAcc) noexcept
+{
+	IrqDisable();
+	asm volatile("":::"memory");
+	uint32_t now1 = SysTick->VAL;
+	const float ret = logf((float)num/(float)den);
+	uint32_t now2 = SysTick->VAL;
+	asm volatile("":::"memory");
+	IrqEnable();
+	now1 &= 0x00FFFFFF;
+	now2 &= 0x00FFFFFF;
+	timeAcc += ((now1 > now2) ? now1 : now1 + (SysTick->LOAD & 0x00FFFFFF) + 1) - now2;
+	return ret;
+}
+
+// Execute a timed natural log of a ratio of ADC readings using fixed point arithmetic, as used by the thermistor code on boards without a FPU
+static float TimedFixedLogRatio(uint32_t num, uint32_t den, uint32_t& timeAcc) noexcept
+{
+	IrqDisable();
+	asm volatile("":::"memory");
+	uint32_t now1 = SysTick->VAL;
+	const float ret = (float)(FixedLog2(num) - FixedLog2(den)) * FixedLogToNaturalLog;
+	uint32_t now2 = SysTick->VAL;
+	asm volatile("":::"memory");
+	IrqEnable();
+	now1 &= 0x00FFFFFF;
+	now2 &= 0x00FFFFFF;
+	timeAcc += ((now1 > now2) ? now1 : now1 + (SysTick->LOAD & 0x00FFFFFF) + 1) - now2;
+	return ret;
+}
+
+#endif
+
 GCodeResult Platform::DoDiagnosticTest(const CanMessageDiagnosticTest& msg, const StringRef& reply)
 {
 	if ((uint16_t)~msg.invertedTestType != msg.testType)
@@ -1941,6 +2454,90 @@ GCodeResult Platform::DoDiagnosticTest(const CanMessageDiagnosticTest& msg, cons
 		}
 		return GCodeResult::ok;
 
+#if SUPPORT_TMC51xx
+	case 109:		// start a coil current capture. param16 = bitmap of drivers, param32[0] = number of samples, bit 0 of param32[1] = also capture TSTEP
+		return (SmartDrivers::StartCoilCurrentCapture(DriversBitmap::MakeFromRaw(msg.param16), msg.param32[0], (msg.param32[1] & 1) != 0, reply))
+				? GCodeResult::ok : GCodeResult::error;
+
+	case 110:		// report captured coil currents, param32[0] = first sample number
+		return (SmartDrivers::AppendCoilCurrentCapture(msg.param32[0], reply)) ? GCodeResult::ok : GCodeResult::error;
+#endif
+
+	case 111:		// set up the coupled heater group, param32[0] = bitmap of heaters (0 to clear the group). The group and its factors are saved in EEPROM.
+		return Heat::ConfigureCoupledHeaters(msg.param32[0], reply);
+
+	case 112:		// set a coupling factor, param16 = heater, param32[0] = heater whose power reaches it, param32[1] = factor in thousandths
+		return Heat::SetCouplingFactor(msg.param16, msg.param32[0], (float)msg.param32[1] * 0.001, reply);
+
+#if HAS_VOLTAGE_MONITOR
+	case 113:		// include a heater in the power budget, param16 = heater, param32[0] = resistance in milliohms (0 to exclude it), param32[1] = priority (0 is highest)
+					// The settings are kept in EEPROM so that they survive a reset of this board, and M122 reports them
+		return Heat::SetHeaterPowerParameters(msg.param16, (float)msg.param32[0] * 0.001, msg.param32[1], reply);
+
+	case 114:		// set the heater power budget, param32[0] = watts (0 for no budget)
+		return Heat::SetPowerBudget((float)msg.param32[0], reply);
+#endif
+
+#if SUPPORT_THERMISTORS
+	case 115:		// Compare the time and accuracy of the floating point and fixed point logarithms used by the thermistor code
+		{
+			uint32_t floatTime = 0, fixedTime = 0;
+			float maxError = 0.0;
+			constexpr uint32_t iterations = 100;				// use a value that divides into one million
+			for (uint32_t i = 0; i < iterations; ++i)
+			{
+				// Cover the range of oversampled ADC reading ratios that we get from thermistors
+				const uint32_t num = 1 + 163 * i;
+				const uint32_t den = (1u << (AnalogIn::AdcBits + 2)) - num;
+				const float floatLog = TimedFloatLogRatio(num, den, floatTime);
+				const float fixedLog = TimedFixedLogRatio(num, den, fixedTime);
+				maxError = max<float>(maxError, fabsf(fixedLog - floatLog));
+			}
+			reply.printf("Log of ADC reading ratio: floating point %.2fus, fixed point %.2fus, max difference %.1e",
+						(double)((float)(floatTime * (1'000'000/iterations))/SystemCoreClockFreq),
+							(double)((float)(fixedTime * (1'000'000/iterations))/SystemCoreClockFreq), (double)maxError);
+			return (maxError < 0.0001) ? GCodeResult::ok : GCodeResult::error;
+		}
+#endif
+
+	case 116:		// set the mode of a digital input monitor, param16 = handle, param32[0] = mode (0 state, 1 debounced state, 2 edge count, 3 frequency), param32[1] = debounce time in microseconds
+		return InputMonitor::SetMode(msg.param16, msg.param32[0], msg.param32[1], reply);
+
+	case 117:		// set how much the count or frequency (in units of 0.1Hz) of an input monitor must change before it is reported, param16 = handle, param32[0] = change
+		return InputMonitor::SetReportThreshold(msg.param16, msg.param32[0], reply);
+
+#if SUPPORT_I2C_SENSORS && SUPPORT_LIS3DH
+	case 118:		// enable (param32[0] = 1) or disable (param32[0] = 0) lossless delta encoding of accelerometer data. The main board must support it.
+		return AccelerometerHandler::SetDeltaEncoding(msg.param32[0] != 0, reply);
+
+	case 119:		// project the accelerometer axes onto a direction and decimate, param16 = decimation factor (0 to turn it off),
+					// low and high 16 bits of param32[0] = signed X and Y components, param32[1] = signed Z component
+		return AccelerometerHandler::SetProjection(msg.param16, (float)(int16_t)(msg.param32[0] & 0xFFFF), (float)(int16_t)(msg.param32[0] >> 16), (float)(int32_t)msg.param32[1], reply);
+#endif
+
+#if SUPPORT_CLOSED_LOOP
+	case 120:		// microstep calibration using the encoder, param32[0] = 0 to calibrate, 1 to use the calibrated table, 2 to use the default table, 3 to report
+		return ClosedLoop::ProcessMicrostepCalibration(msg.param32[0], reply);
+#endif
+
+	case 121:		// set the thermostatic fan response, param16 = fan number, param32[0] = response curve exponent * 100 (0 to report), param32[1] = slew limit in percent per second (0 for none)
+		return FansManager::SetThermostaticResponse(msg.param16, (float)msg.param32[0] * 0.01, (float)msg.param32[1] * 0.01, reply);
+
+	case 122:		// change the CAN timing at a master step clock time without a reset, param32[0] = period (low 16 bits) and tseg1 (high 16 bits) in CAN clocks, 0 to report statistics,
+					// param32[1] = master step clock time to change, param16 = jump width (low 8 bits) and error count threshold for falling back (high 8 bits, 0 for default)
+		if (msg.param32[0] == 0)
+		{
+			CanInterface::ReportTimingStats(reply);
+			return GCodeResult::ok;
+		}
+		return CanInterface::ScheduleTimingChange(msg.param32[1], msg.param32[0] & 0xFFFF, msg.param32[0] >> 16, msg.param16 & 0xFF, msg.param16 >> 8, reply);
+
+#if HAS_SMART_DRIVERS
+	case 123:		// automatic idle current between moves, param16 = idle current percent, param32[0] = delay after the last move in milliseconds (0 to turn it off),
+					// param32[1] = how long before the next move to restore the current in microseconds (0 for default), all zero to report
+		return SetAutoIdle(msg.param32[0], msg.param32[1], msg.param16, reply);
+#endif
+
 	case 1001:	// test watchdog
 		deferredCommand = DeferredCommand::testWatchdog;
 		return GCodeResult::ok;
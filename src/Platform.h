@@ -48,6 +48,7 @@ constexpr size_t VrefFilterIndex = NumThermistorInputs + 1;
 constexpr size_t SdAdcTemp0FilterIndex = NumThermistorInputs + 2;
 constexpr size_t SdAdcVrefFilterIndex = NumThermistorInputs + 3;
 constexpr size_t NumThermistorFilters = NumThermistorInputs + 4;
+constexpr size_t FirstSdAdcFilterIndex = SdAdcTemp0FilterIndex;
 #  else
 // SAME51 or not supporting SDADC
 constexpr size_t NumThermistorFilters = NumThermistorInputs + 2;
@@ -61,10 +62,21 @@ constexpr size_t NumThermistorFilters = NumThermistorInputs + 2;
 constexpr size_t SdAdcTemp0FilterIndex = NumThermistorInputs;
 constexpr size_t SdAdcVrefFilterIndex = NumThermistorInputs + 1;
 constexpr size_t NumThermistorFilters = NumThermistorInputs + 2;
+constexpr size_t FirstSdAdcFilterIndex = SdAdcTemp0FilterIndex;
 #  else
 constexpr size_t NumThermistorFilters = NumThermistorInputs;
 #  endif
 
+# endif
+
+# if SAMC21 && SUPPORT_SDADC
+// The SDADC oversamples and decimates in hardware, so its readings have much less noise than those from the ADC.
+// Therefore we average fewer of them, which reduces the delay in the temperature readings.
+// AnalogIn delivers SDADC results scaled to AnalogIn::AdcBits like ADC results, so this does not increase the resolution of the readings.
+// Only the filter length differs; the SDADC is read through AnalogIn in the same way as the ADC, and DmacChanSdadcRx is not used.
+constexpr size_t SdAdcReadingsAveraged = 16;
+typedef AdcAveragingFilter<SdAdcReadingsAveraged> SdAdcAveragingFilter;
+constexpr size_t NumSdAdcFilters = NumThermistorFilters - FirstSdAdcFilterIndex;
 # endif
 #endif
 
@@ -139,6 +151,8 @@ namespace Platform
 
 	void Init();
 	void InitMinimal();
+	void InitDeferred();
+	void AppendStartupTimes(const StringRef& reply);
 	void Spin();
 	void SpinMinimal();
 
@@ -157,9 +171,7 @@ namespace Platform
 	void SetDriveStepsPerUnit(size_t drive, float val);
 	float GetPressureAdvanceClocks(size_t driver);
 	void SetPressureAdvance(size_t driver, float advance);
-# if 0	// not used yet and may never be
 	void BuildDriverStatusMessage(CanMessageBuffer *buf) noexcept;
-# endif
 
 # if SINGLE_DRIVER
 	inline void StepDriverLow()
@@ -214,23 +226,31 @@ namespace Platform
 	void SetEnableValue(size_t driver, int8_t eVal);
 	int8_t GetEnableValue(size_t driver);
 	void EnableDrive(size_t driver);
+	void EnableDriveForMove(size_t driver, uint32_t startTime, uint32_t finishTime);
 	void DisableDrive(size_t driver);
 	void DisableAllDrives();
 	void SetDriverIdle(size_t driver, uint8_t percent);
 
 #if HAS_SMART_DRIVERS
+	GCodeResult SetAutoIdle(uint32_t delayMillis, uint32_t leadMicroseconds, uint8_t percent, const StringRef& reply);
+	void AppendAutoIdleStatus(const StringRef& reply);
 	void SetMotorCurrent(size_t driver, float current);		//TODO avoid the int->float->int conversion
 	float GetTmcDriversTemperature();
+	void AppendThermalDerating(size_t driver, const StringRef& reply);
+	void AppendDriverFaultReports(const StringRef& reply);
 #endif
 #endif	//SUPPORT_DRIVERS
 
 #if SUPPORT_THERMISTORS
 	int GetAveragingFilterIndex(const IoPort&);
-	ThermistorAveragingFilter *GetAdcFilter(unsigned int filterNumber);
+	void InitAdcFilter(unsigned int filterNumber, uint16_t val);
+	bool IsAdcFilterValid(unsigned int filterNumber);
+	uint32_t GetAveragedAdcReading(unsigned int filterNumber, unsigned int oversampleBits);	// get the average reading scaled to AdcBits + oversampleBits bits
+	uint16_t GetLatestAdcReading(unsigned int filterNumber);
 
 # if HAS_VREF_MONITOR
-	ThermistorAveragingFilter *GetVssaFilter(unsigned int filterNumber);
-	ThermistorAveragingFilter *GetVrefFilter(unsigned int filterNumber);
+	int GetVssaFilterIndex(unsigned int filterNumber);				// returns -1 if there is no VSSA filter for this input
+	unsigned int GetVrefFilterIndex(unsigned int filterNumber);
 # endif
 #endif
 
@@ -17,6 +17,7 @@ namespace TaskPriority
 	static constexpr int AinPriority = 2;
 	static constexpr int CanReceiverPriority = 3;
 	static constexpr int MovePriority = 3;
+	static constexpr int AutoIdlePriority = 3;
 	static constexpr int CanAsyncSenderPriority = 4;
 	static constexpr int CanClockPriority = 4;
 	static constexpr int Accelerometer = 3;
@@ -10,9 +10,11 @@
 #include <TaskPriorities.h>
 #include <Movement/Move.h>
 #include <Heating/Heat.h>
+#include <Fans/FansManager.h>
 #include <InputMonitors/InputMonitor.h>
 #include <CommandProcessing/CommandProcessor.h>
 #include <FilamentMonitors/FilamentMonitor.h>
+#include <ClosedLoop/ClosedLoop.h>
 #include <Hardware/Devices.h>
 #include <Hardware/NonVolatileMemory.h>
 #include <CanMessageBuffer.h>
@@ -222,6 +224,7 @@ void AppMain() noexcept
 extern "C" [[noreturn]] void MainTask(void *pvParameters) noexcept
 {
 	Platform::Init();
+	FansManager::Init();
 	Heat::Init();
 	InputMonitor::Init();
 
@@ -230,12 +233,17 @@ extern "C" [[noreturn]] void MainTask(void *pvParameters) noexcept
 	moveInstance->Init();
 #endif
 
+	Platform::InitDeferred();						// the Heat task is already running and announcing us, so probe optional devices now
+
 	for (;;)
 	{
 		Platform::Spin();
 		CommandProcessor::Spin();
 #if SUPPORT_DRIVERS
 		FilamentMonitor::Spin();
+#endif
+#if SUPPORT_CLOSED_LOOP
+		ClosedLoop::Spin();
 #endif
 	}
 }